@@ -0,0 +1,753 @@
+#include "analysis.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+Operation Decode(uint16_t opcode)
+{
+	uint8_t low = opcode & 0x000Fu;
+	switch ((opcode & 0xF000u) >> 12u)
+	{
+	case 0x0:
+		return low == 0x0 ? Operation::Cls : (low == 0xE ? Operation::Ret : Operation::Null);
+	case 0x1:
+		return Operation::Jp;
+	case 0x2:
+		return Operation::Call;
+	case 0x3:
+		return Operation::SeByte;
+	case 0x4:
+		return Operation::SneByte;
+	case 0x5:
+		return Operation::SeReg;
+	case 0x6:
+		return Operation::LdByte;
+	case 0x7:
+		return Operation::AddByte;
+	case 0x8:
+		switch (low)
+		{
+		case 0x0:
+			return Operation::LdReg;
+		case 0x1:
+			return Operation::Or;
+		case 0x2:
+			return Operation::And;
+		case 0x3:
+			return Operation::Xor;
+		case 0x4:
+			return Operation::AddReg;
+		case 0x5:
+			return Operation::Sub;
+		case 0x6:
+			return Operation::Shr;
+		case 0x7:
+			return Operation::Subn;
+		case 0xE:
+			return Operation::Shl;
+		}
+		return Operation::Null;
+	case 0x9:
+		return Operation::SneReg;
+	case 0xA:
+		return Operation::LdI;
+	case 0xB:
+		return Operation::JpV0;
+	case 0xC:
+		return Operation::Rnd;
+	case 0xD:
+		return Operation::Drw;
+	case 0xE:
+		return low == 0xE ? Operation::Skp : (low == 0x1 ? Operation::Sknp : Operation::Null);
+	case 0xF:
+		switch (opcode & 0x00FFu)
+		{
+		case 0x07:
+			return Operation::LdVxDt;
+		case 0x0A:
+			return Operation::LdVxK;
+		case 0x15:
+			return Operation::LdDtVx;
+		case 0x18:
+			return Operation::LdStVx;
+		case 0x1E:
+			return Operation::AddI;
+		case 0x29:
+			return Operation::LdF;
+		case 0x33:
+			return Operation::LdB;
+		case 0x55:
+			return Operation::StoreRegs;
+		case 0x65:
+			return Operation::LoadRegs;
+		}
+		return Operation::Null;
+	}
+	return Operation::Null;
+}
+
+bool IsValidOpcode(uint16_t opcode)
+{
+	return Decode(opcode) != Operation::Null;
+}
+
+std::string Disassemble(uint16_t opcode)
+{
+	unsigned int x = (opcode & 0x0F00u) >> 8u;
+	unsigned int y = (opcode & 0x00F0u) >> 4u;
+	unsigned int n = opcode & 0x000Fu;
+	unsigned int kk = opcode & 0x00FFu;
+	unsigned int nnn = opcode & 0x0FFFu;
+	char text[32];
+
+	switch (Decode(opcode))
+	{
+	case Operation::Null:
+		std::snprintf(text, sizeof(text), "DW 0x%04X", opcode);
+		break;
+	case Operation::Cls:
+		std::snprintf(text, sizeof(text), "CLS");
+		break;
+	case Operation::Ret:
+		std::snprintf(text, sizeof(text), "RET");
+		break;
+	case Operation::Jp:
+		std::snprintf(text, sizeof(text), "JP 0x%03X", nnn);
+		break;
+	case Operation::Call:
+		std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn);
+		break;
+	case Operation::SeByte:
+		std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk);
+		break;
+	case Operation::SneByte:
+		std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk);
+		break;
+	case Operation::SeReg:
+		std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y);
+		break;
+	case Operation::LdByte:
+		std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk);
+		break;
+	case Operation::AddByte:
+		std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk);
+		break;
+	case Operation::LdReg:
+		std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y);
+		break;
+	case Operation::Or:
+		std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y);
+		break;
+	case Operation::And:
+		std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y);
+		break;
+	case Operation::Xor:
+		std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y);
+		break;
+	case Operation::AddReg:
+		std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y);
+		break;
+	case Operation::Sub:
+		std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y);
+		break;
+	case Operation::Shr:
+		std::snprintf(text, sizeof(text), "SHR V%X", x);
+		break;
+	case Operation::Subn:
+		std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y);
+		break;
+	case Operation::Shl:
+		std::snprintf(text, sizeof(text), "SHL V%X", x);
+		break;
+	case Operation::SneReg:
+		std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y);
+		break;
+	case Operation::LdI:
+		std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn);
+		break;
+	case Operation::JpV0:
+		std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn);
+		break;
+	case Operation::Rnd:
+		std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk);
+		break;
+	case Operation::Drw:
+		std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n);
+		break;
+	case Operation::Skp:
+		std::snprintf(text, sizeof(text), "SKP V%X", x);
+		break;
+	case Operation::Sknp:
+		std::snprintf(text, sizeof(text), "SKNP V%X", x);
+		break;
+	case Operation::LdVxDt:
+		std::snprintf(text, sizeof(text), "LD V%X, DT", x);
+		break;
+	case Operation::LdVxK:
+		std::snprintf(text, sizeof(text), "LD V%X, K", x);
+		break;
+	case Operation::LdDtVx:
+		std::snprintf(text, sizeof(text), "LD DT, V%X", x);
+		break;
+	case Operation::LdStVx:
+		std::snprintf(text, sizeof(text), "LD ST, V%X", x);
+		break;
+	case Operation::AddI:
+		std::snprintf(text, sizeof(text), "ADD I, V%X", x);
+		break;
+	case Operation::LdF:
+		std::snprintf(text, sizeof(text), "LD F, V%X", x);
+		break;
+	case Operation::LdB:
+		std::snprintf(text, sizeof(text), "LD B, V%X", x);
+		break;
+	case Operation::StoreRegs:
+		std::snprintf(text, sizeof(text), "LD [I], V%X", x);
+		break;
+	case Operation::LoadRegs:
+		std::snprintf(text, sizeof(text), "LD V%X, [I]", x);
+		break;
+	}
+	return text;
+}
+
+// Map an instruction onto the way it ends a block, or Fallthrough if it
+// does not affect control flow
+static BlockExit ExitOf(Operation operation)
+{
+	switch (operation)
+	{
+	case Operation::Jp:
+		return BlockExit::Jump;
+	case Operation::Call:
+		return BlockExit::Call;
+	case Operation::Ret:
+		return BlockExit::Return;
+	case Operation::SeByte:
+	case Operation::SneByte:
+	case Operation::SeReg:
+	case Operation::SneReg:
+	case Operation::Skp:
+	case Operation::Sknp:
+		return BlockExit::Skip;
+	case Operation::JpV0:
+		return BlockExit::Indirect;
+	case Operation::LdVxK:
+		return BlockExit::Wait;
+	case Operation::Null:
+		return BlockExit::Invalid;
+	default:
+		return BlockExit::Fallthrough;
+	}
+}
+
+static char const *ExitName(BlockExit exit)
+{
+	switch (exit)
+	{
+	case BlockExit::Fallthrough:
+		return "fallthrough";
+	case BlockExit::Jump:
+		return "jump";
+	case BlockExit::Call:
+		return "call";
+	case BlockExit::Return:
+		return "return";
+	case BlockExit::Skip:
+		return "skip";
+	case BlockExit::Indirect:
+		return "indirect";
+	case BlockExit::Wait:
+		return "wait";
+	case BlockExit::Invalid:
+		return "invalid";
+	case BlockExit::End:
+		return "end";
+	}
+	return "";
+}
+
+RomAnalysis::RomAnalysis(Chip8 const &chip8)
+	: RomAnalysis(chip8.GetMemory(), ROM_START_ADDRESS + chip8.GetRomSize())
+{
+}
+
+RomAnalysis::RomAnalysis(uint8_t const *memory, uint16_t romEnd)
+	: memory(memory), romEnd(std::min<uint16_t>(romEnd, MEMORY_SIZE)), byteKinds(MEMORY_SIZE, ByteKind::Unknown)
+{
+	Analyze();
+}
+
+void RomAnalysis::Analyze()
+{
+	TraceInstructions();
+	BuildBlocks();
+	BuildFunctions();
+	ClassifyData();
+	FindSelfModifyingWrites();
+}
+
+bool RomAnalysis::InRom(unsigned int address) const
+{
+	return address >= ROM_START_ADDRESS && address + 1 < romEnd;
+}
+
+uint16_t RomAnalysis::GetOpcode(uint16_t address) const
+{
+	return (memory[address % MEMORY_SIZE] << 8u) | memory[(address + 1) % MEMORY_SIZE];
+}
+
+ByteKind RomAnalysis::GetByteKind(uint16_t address) const
+{
+	return address < MEMORY_SIZE ? byteKinds[address] : ByteKind::Unknown;
+}
+
+BasicBlock const *RomAnalysis::FindBlock(uint16_t address) const
+{
+	auto it = blocks.upper_bound(address);
+	if (it == blocks.begin())
+	{
+		return nullptr;
+	}
+	--it;
+	return address < it->second.end ? &it->second : nullptr;
+}
+
+// Recursive traversal: follow every statically known successor of every
+// reachable instruction and remember where blocks must begin
+void RomAnalysis::TraceInstructions()
+{
+	std::vector<uint16_t> worklist;
+	auto addTarget = [&](unsigned int address)
+	{
+		if (InRom(address))
+		{
+			leaders.set(address);
+			worklist.push_back(address);
+		}
+	};
+
+	addTarget(ROM_START_ADDRESS);
+	functions[ROM_START_ADDRESS].entry = ROM_START_ADDRESS;
+
+	while (!worklist.empty())
+	{
+		uint16_t address = worklist.back();
+		worklist.pop_back();
+
+		while (InRom(address) && !visited.test(address))
+		{
+			visited.set(address);
+			byteKinds[address] = ByteKind::Code;
+			byteKinds[address + 1] = ByteKind::Code;
+
+			uint16_t opcode = GetOpcode(address);
+			uint16_t nnn = opcode & 0x0FFFu;
+			BlockExit exit = ExitOf(Decode(opcode));
+
+			if (exit == BlockExit::Fallthrough)
+			{
+				address += 2;
+				continue;
+			}
+
+			switch (exit)
+			{
+			case BlockExit::Jump:
+				addTarget(nnn);
+				break;
+			case BlockExit::Call:
+				if (InRom(nnn))
+				{
+					functions[nnn].entry = nnn;
+				}
+				addTarget(nnn);
+				addTarget(address + 2);
+				break;
+			case BlockExit::Skip:
+				addTarget(address + 2);
+				addTarget(address + 4);
+				break;
+			case BlockExit::Indirect:
+				// Only the V0 = 0 target is known; anything else is left to
+				// the interpreter at run time
+				indirectJumps.push_back(address);
+				addTarget(nnn);
+				break;
+			case BlockExit::Wait:
+				// Fx0A loops on itself, so it starts its own block and the
+				// loop is a self-edge rather than an edge into a block
+				addTarget(address);
+				addTarget(address + 2);
+				break;
+			default:
+				break;
+			}
+			break;
+		}
+	}
+}
+
+void RomAnalysis::BuildBlocks()
+{
+	for (unsigned int start = ROM_START_ADDRESS; start < romEnd; ++start)
+	{
+		if (!leaders.test(start) || !visited.test(start))
+		{
+			continue;
+		}
+
+		BasicBlock block{};
+		block.start = start;
+		block.exit = BlockExit::End;
+
+		unsigned int address = start;
+		while (InRom(address) && visited.test(address))
+		{
+			uint16_t opcode = GetOpcode(address);
+			BlockExit exit = ExitOf(Decode(opcode));
+			unsigned int next = address + 2;
+
+			if (exit != BlockExit::Fallthrough)
+			{
+				block.exit = exit;
+				block.end = next;
+				uint16_t nnn = opcode & 0x0FFFu;
+				switch (exit)
+				{
+				case BlockExit::Jump:
+					block.successors.push_back(nnn);
+					break;
+				case BlockExit::Call:
+					block.callTarget = nnn;
+					block.successors.push_back(next);
+					break;
+				case BlockExit::Skip:
+					block.successors.push_back(next);
+					block.successors.push_back(next + 2);
+					break;
+				case BlockExit::Indirect:
+					block.successors.push_back(nnn);
+					break;
+				case BlockExit::Wait:
+					block.successors.push_back(address);
+					block.successors.push_back(next);
+					break;
+				default:
+					break;
+				}
+				break;
+			}
+
+			block.end = next;
+			if (leaders.test(next))
+			{
+				block.exit = BlockExit::Fallthrough;
+				block.successors.push_back(next);
+				break;
+			}
+			address = next;
+		}
+
+		// Drop successors that point outside the ROM; they are still visible
+		// through the exit kind and the instruction itself
+		block.successors.erase(
+			std::remove_if(block.successors.begin(), block.successors.end(),
+						   [this](uint16_t target)
+						   { return !InRom(target); }),
+			block.successors.end());
+		blocks[block.start] = block;
+	}
+}
+
+// Group blocks into functions by walking intraprocedural edges from each entry.
+// A call edge continues at the return site, the callee is recorded separately.
+void RomAnalysis::BuildFunctions()
+{
+	for (auto &entry : functions)
+	{
+		Function &function = entry.second;
+		std::set<uint16_t> seen;
+		std::set<uint16_t> callees;
+		std::vector<uint16_t> worklist{function.entry};
+
+		while (!worklist.empty())
+		{
+			uint16_t start = worklist.back();
+			worklist.pop_back();
+			auto it = blocks.find(start);
+			if (it == blocks.end() || !seen.insert(start).second)
+			{
+				continue;
+			}
+
+			BasicBlock const &block = it->second;
+			if (block.exit == BlockExit::Call && InRom(block.callTarget))
+			{
+				callees.insert(block.callTarget);
+			}
+			for (uint16_t successor : block.successors)
+			{
+				worklist.push_back(successor);
+			}
+		}
+
+		function.blocks.assign(seen.begin(), seen.end());
+		function.callees.assign(callees.begin(), callees.end());
+	}
+}
+
+// Mark the bytes read by Dxyn and Fx65 through an index loaded by Annn in the
+// same block as data. Other unreached ROM bytes stay Unknown.
+void RomAnalysis::ClassifyData()
+{
+	for (auto const &entry : blocks)
+	{
+		BasicBlock const &block = entry.second;
+		int index = -1;
+
+		for (unsigned int address = block.start; address < block.end; address += 2)
+		{
+			uint16_t opcode = GetOpcode(address);
+			unsigned int length = 0;
+
+			switch (Decode(opcode))
+			{
+			case Operation::LdI:
+				index = opcode & 0x0FFFu;
+				break;
+			case Operation::AddI:
+			case Operation::LdF:
+				index = -1;
+				break;
+			case Operation::Drw:
+				length = opcode & 0x000Fu;
+				break;
+			case Operation::LoadRegs:
+				length = ((opcode & 0x0F00u) >> 8u) + 1;
+				break;
+			default:
+				break;
+			}
+
+			for (unsigned int i = 0; index >= 0 && i < length; ++i)
+			{
+				unsigned int target = index + i;
+				if (target >= ROM_START_ADDRESS && target < romEnd && byteKinds[target] != ByteKind::Code)
+				{
+					byteKinds[target] = ByteKind::Data;
+				}
+			}
+		}
+	}
+}
+
+// A store whose index was set by Annn earlier in the same block can be
+// resolved statically; anything else might write anywhere
+void RomAnalysis::FindSelfModifyingWrites()
+{
+	for (auto &entry : blocks)
+	{
+		BasicBlock const &block = entry.second;
+		int index = -1;
+
+		for (unsigned int address = block.start; address < block.end; address += 2)
+		{
+			uint16_t opcode = GetOpcode(address);
+			unsigned int length = 0;
+
+			switch (Decode(opcode))
+			{
+			case Operation::LdI:
+				index = opcode & 0x0FFFu;
+				break;
+			case Operation::AddI:
+			case Operation::LdF:
+				index = -1;
+				break;
+			case Operation::LdB:
+				length = 3;
+				break;
+			case Operation::StoreRegs:
+				length = ((opcode & 0x0F00u) >> 8u) + 1;
+				break;
+			default:
+				break;
+			}
+
+			if (length == 0)
+			{
+				continue;
+			}
+
+			if (index < 0)
+			{
+				selfModifyingWrites.push_back({static_cast<uint16_t>(address), 0, static_cast<uint16_t>(length), false});
+				continue;
+			}
+
+			bool hitsCode = false;
+			for (unsigned int i = 0; i < length; ++i)
+			{
+				if (GetByteKind(index + i) == ByteKind::Code)
+				{
+					hitsCode = true;
+				}
+			}
+			if (!hitsCode)
+			{
+				continue;
+			}
+
+			selfModifyingWrites.push_back({static_cast<uint16_t>(address), static_cast<uint16_t>(index), static_cast<uint16_t>(length), true});
+			for (auto &other : blocks)
+			{
+				BasicBlock &target = other.second;
+				if (target.start < index + length && static_cast<unsigned int>(index) < target.end)
+				{
+					target.selfModified = true;
+				}
+			}
+		}
+	}
+}
+
+void RomAnalysis::DumpText(std::ostream &out) const
+{
+	char line[96];
+
+	for (auto const &entry : functions)
+	{
+		Function const &function = entry.second;
+		std::snprintf(line, sizeof(line), "function 0x%03X", function.entry);
+		out << line;
+		if (!function.callees.empty())
+		{
+			out << " calls";
+			for (uint16_t callee : function.callees)
+			{
+				std::snprintf(line, sizeof(line), " 0x%03X", callee);
+				out << line;
+			}
+		}
+		out << '\n';
+	}
+	out << '\n';
+
+	for (auto const &entry : blocks)
+	{
+		BasicBlock const &block = entry.second;
+		std::snprintf(line, sizeof(line), "block 0x%03X-0x%03X %s%s", block.start, block.end - 1,
+					  ExitName(block.exit), block.selfModified ? " self-modified" : "");
+		out << line;
+		for (uint16_t successor : block.successors)
+		{
+			std::snprintf(line, sizeof(line), " -> 0x%03X", successor);
+			out << line;
+		}
+		out << '\n';
+
+		for (unsigned int address = block.start; address < block.end; address += 2)
+		{
+			uint16_t opcode = GetOpcode(address);
+			std::snprintf(line, sizeof(line), "  0x%03X  %04X  %s\n", address, opcode, Disassemble(opcode).c_str());
+			out << line;
+		}
+	}
+
+	// Everything in the ROM that was not reached as code
+	unsigned int address = ROM_START_ADDRESS;
+	while (address < romEnd)
+	{
+		if (byteKinds[address] == ByteKind::Code)
+		{
+			++address;
+			continue;
+		}
+		unsigned int start = address;
+		while (address < romEnd && byteKinds[address] != ByteKind::Code)
+		{
+			++address;
+		}
+		bool sprite = std::any_of(byteKinds.begin() + start, byteKinds.begin() + address,
+								  [](ByteKind kind)
+								  { return kind == ByteKind::Data; });
+		std::snprintf(line, sizeof(line), "\n%s 0x%03X-0x%03X\n", sprite ? "data" : "unreached", start, address - 1);
+		out << line;
+		for (unsigned int i = start; i < address; ++i)
+		{
+			std::snprintf(line, sizeof(line), "%s%02X", ((i - start) % 16 == 0) ? "  " : " ", memory[i]);
+			out << line;
+			if ((i - start) % 16 == 15 || i + 1 == address)
+			{
+				out << '\n';
+			}
+		}
+	}
+
+	if (!selfModifyingWrites.empty())
+	{
+		out << '\n';
+	}
+	for (SelfModifyingWrite const &write : selfModifyingWrites)
+	{
+		if (write.resolved)
+		{
+			std::snprintf(line, sizeof(line), "self-modifying write at 0x%03X to 0x%03X-0x%03X\n",
+						  write.writer, write.start, write.start + write.length - 1);
+		}
+		else
+		{
+			std::snprintf(line, sizeof(line), "unresolved store at 0x%03X\n", write.writer);
+		}
+		out << line;
+	}
+	for (uint16_t address : indirectJumps)
+	{
+		std::snprintf(line, sizeof(line), "indirect jump at 0x%03X\n", address);
+		out << line;
+	}
+}
+
+void RomAnalysis::DumpDot(std::ostream &out) const
+{
+	char line[96];
+
+	out << "digraph cfg {\n";
+	out << "  node [shape=box fontname=\"monospace\"];\n";
+
+	for (auto const &entry : blocks)
+	{
+		BasicBlock const &block = entry.second;
+		std::snprintf(line, sizeof(line), "  b%03X [label=\"", block.start);
+		out << line;
+		for (unsigned int address = block.start; address < block.end; address += 2)
+		{
+			std::snprintf(line, sizeof(line), "%03X: %s\\l", address, Disassemble(GetOpcode(address)).c_str());
+			out << line;
+		}
+		out << '"';
+		if (block.selfModified)
+		{
+			out << " color=red";
+		}
+		if (functions.count(block.start))
+		{
+			out << " peripheries=2";
+		}
+		out << "];\n";
+
+		for (uint16_t successor : block.successors)
+		{
+			std::snprintf(line, sizeof(line), "  b%03X -> b%03X;\n", block.start, successor);
+			out << line;
+		}
+		if (block.exit == BlockExit::Call && blocks.count(block.callTarget))
+		{
+			std::snprintf(line, sizeof(line), "  b%03X -> b%03X [style=dashed];\n", block.start, block.callTarget);
+			out << line;
+		}
+	}
+
+	out << "}\n";
+}
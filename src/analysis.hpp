@@ -0,0 +1,148 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+const unsigned int ROM_START_ADDRESS = 0x200;
+
+// How control leaves a basic block
+enum class BlockExit
+{
+	Fallthrough, // next instruction is the start of another block
+	Jump,		 // 1nnn
+	Call,		 // 2nnn, continues at the return site once the callee returns
+	Return,		 // 00EE
+	Skip,		 // 3xkk, 4xkk, 5xy0, 9xy0, Ex9E, ExA1
+	Indirect,	 // Bnnn, target depends on V0 at run time
+	Wait,		 // Fx0A, re-executes until a key is pressed
+	Invalid,	 // opcode the interpreter treats as OP_NULL, likely data
+	End			 // ran off the end of the ROM
+};
+
+enum class ByteKind : uint8_t
+{
+	Unknown,
+	Code,
+	Data
+};
+
+struct BasicBlock
+{
+	uint16_t start;
+	uint16_t end; // one past the last byte of the last instruction
+	BlockExit exit;
+	std::vector<uint16_t> successors;
+	uint16_t callTarget;  // valid when exit is Call
+	bool selfModified;	  // a Fx33/Fx55 in the ROM may overwrite this block
+};
+
+struct Function
+{
+	uint16_t entry;
+	std::vector<uint16_t> blocks;
+	std::vector<uint16_t> callees;
+};
+
+// A store (Fx33/Fx55) whose target overlaps code. Stores through an index
+// that cannot be resolved statically are reported with resolved = false.
+struct SelfModifyingWrite
+{
+	uint16_t writer;
+	uint16_t start;
+	uint16_t length;
+	bool resolved;
+};
+
+// One entry per Chip8 OP_* handler. Decode() follows the same bits as the
+// interpreter's function pointer tables, so for example 0x0120 decodes as CLS
+// because Table0 only looks at the lowest nibble.
+enum class Operation : uint8_t
+{
+	Null,
+	Cls,	   // 00E0
+	Ret,	   // 00EE
+	Jp,		   // 1nnn
+	Call,	   // 2nnn
+	SeByte,	   // 3xkk
+	SneByte,   // 4xkk
+	SeReg,	   // 5xy0
+	LdByte,	   // 6xkk
+	AddByte,   // 7xkk
+	LdReg,	   // 8xy0
+	Or,		   // 8xy1
+	And,	   // 8xy2
+	Xor,	   // 8xy3
+	AddReg,	   // 8xy4
+	Sub,	   // 8xy5
+	Shr,	   // 8xy6
+	Subn,	   // 8xy7
+	Shl,	   // 8xyE
+	SneReg,	   // 9xy0
+	LdI,	   // Annn
+	JpV0,	   // Bnnn
+	Rnd,	   // Cxkk
+	Drw,	   // Dxyn
+	Skp,	   // Ex9E
+	Sknp,	   // ExA1
+	LdVxDt,	   // Fx07
+	LdVxK,	   // Fx0A
+	LdDtVx,	   // Fx15
+	LdStVx,	   // Fx18
+	AddI,	   // Fx1E
+	LdF,	   // Fx29
+	LdB,	   // Fx33
+	StoreRegs, // Fx55
+	LoadRegs   // Fx65
+};
+
+Operation Decode(uint16_t opcode);
+std::string Disassemble(uint16_t opcode);
+bool IsValidOpcode(uint16_t opcode);
+
+// Static control-flow recovery for a ROM image. Code is found by recursive
+// traversal from 0x200 following jumps, calls, returns and skips; everything
+// in the ROM that is never reached is treated as data.
+class RomAnalysis
+{
+public:
+	explicit RomAnalysis(Chip8 const &chip8);
+	RomAnalysis(uint8_t const *memory, uint16_t romEnd);
+
+	std::map<uint16_t, BasicBlock> const &GetBlocks() const { return blocks; }
+	std::map<uint16_t, Function> const &GetFunctions() const { return functions; }
+	std::vector<SelfModifyingWrite> const &GetSelfModifyingWrites() const { return selfModifyingWrites; }
+	std::vector<uint16_t> const &GetIndirectJumps() const { return indirectJumps; }
+	BasicBlock const *FindBlock(uint16_t address) const;
+	ByteKind GetByteKind(uint16_t address) const;
+	uint16_t GetOpcode(uint16_t address) const;
+	uint8_t const *GetMemory() const { return memory; }
+	uint16_t GetRomEnd() const { return romEnd; }
+
+	void DumpText(std::ostream &out) const;
+	void DumpDot(std::ostream &out) const;
+
+private:
+	uint8_t const *memory;
+	uint16_t romEnd;
+
+	std::bitset<MEMORY_SIZE> visited; // instruction start addresses
+	std::bitset<MEMORY_SIZE> leaders;
+	std::vector<ByteKind> byteKinds;
+	std::map<uint16_t, BasicBlock> blocks;
+	std::map<uint16_t, Function> functions;
+	std::vector<SelfModifyingWrite> selfModifyingWrites;
+	std::vector<uint16_t> indirectJumps;
+
+	void Analyze();
+	bool InRom(unsigned int address) const;
+	void TraceInstructions();
+	void BuildBlocks();
+	void BuildFunctions();
+	void ClassifyData();
+	void FindSelfModifyingWrites();
+};
@@ -0,0 +1,42 @@
+#include "aot.hpp"
+#include <cstring>
+
+AotBackend::AotBackend(AotProgram const *program)
+{
+	for (uint32_t i = 0; i < program->blockCount; ++i)
+	{
+		AotBlock const &block = program->blocks[i];
+		if (block.start + block.length <= MEMORY_SIZE)
+		{
+			lookup[block.start] = &block;
+		}
+	}
+}
+
+unsigned int AotBackend::Step(Chip8 &chip8, unsigned int budget)
+{
+	AotContext context(chip8, &AotContext::ExecuteCurrent);
+	uint16_t pc = context.Pc();
+
+	AotBlock const *block = pc < MEMORY_SIZE ? lookup[pc] : nullptr;
+	if (block && block->instructions <= budget &&
+		std::memcmp(context.Memory() + pc, block->bytes, block->length) == 0)
+	{
+		block->run(context);
+		compiledCycles += block->instructions;
+		return block->instructions;
+	}
+
+	unsigned int cycles = chip8.Step(budget);
+	interpretedCycles += cycles;
+	return cycles;
+}
+
+void AotBackend::Run(Chip8 &chip8, uint64_t cycles)
+{
+	while (cycles > 0)
+	{
+		unsigned int budget = cycles > 0xFFFFu ? 0xFFFFu : static_cast<unsigned int>(cycles);
+		cycles -= Step(chip8, budget);
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Bump when AotContext or the structures below change layout, so that stale
+// plug-ins are rejected instead of corrupting the machine. Changes to Chip8's
+// own layout are also caught by the size and offsets stored in AotProgram.
+const uint32_t AOT_PROGRAM_VERSION = 4;
+
+// The view of a Chip8 that recompiled code operates on. Every accessor is
+// inline so generated blocks compile down to direct loads and stores; the only
+// call back into the interpreter goes through the execute pointer the host
+// fills in, which keeps plug-ins free of undefined symbols.
+class AotContext
+{
+public:
+	AotContext(Chip8 &chip8, void (*execute)(Chip8 &))
+		: chip8(chip8), execute(execute)
+	{
+	}
+
+	uint8_t V(unsigned int x) const { return chip8.registers[x]; }
+	void SetV(unsigned int x, uint8_t value) { chip8.SetRegister(x, value); }
+	uint16_t I() const { return chip8.index; }
+	void SetI(uint16_t value) { chip8.index = value; }
+	uint16_t Pc() const { return chip8.pc; }
+	void SetPc(uint16_t value) { chip8.pc = value; }
+	uint8_t const *Memory() const { return chip8.memory; }
+	uint8_t DelayTimer() const { return chip8.delayTimer; }
+	void SetDelayTimer(uint8_t value) { chip8.delayTimer = value; }
+	void SetSoundTimer(uint8_t value) { chip8.soundTimer = value; }
+
+	// Same as n timer decrements at the end of n calls to Cycle()
+	void Tick(unsigned int n)
+	{
+		chip8.delayTimer = chip8.delayTimer > n ? chip8.delayTimer - n : 0;
+		chip8.soundTimer = chip8.soundTimer > n ? chip8.soundTimer - n : 0;
+	}
+
+	// Run one opcode through the interpreter's handlers with pc already
+	// pointing past it, exactly as Cycle() would after the fetch
+	void Exec(uint16_t opcode, uint16_t nextPc)
+	{
+		chip8.opcode = opcode;
+		chip8.pc = nextPc;
+		execute(chip8);
+	}
+
+	// Host side only
+	static void ExecuteCurrent(Chip8 &chip8) { chip8.Execute(); }
+
+	// The inline accessors bake Chip8's field offsets into every plug-in, so
+	// a plug-in records the layout it was compiled against
+	static constexpr uint32_t MachineSize() { return sizeof(Chip8); }
+	static constexpr uint32_t FieldOffsets()
+	{
+		return static_cast<uint32_t>(offsetof(Chip8, stateHash) | offsetof(Chip8, pc) << 8u |
+									 offsetof(Chip8, memory) << 16u);
+	}
+
+private:
+	Chip8 &chip8;
+	void (*execute)(Chip8 &);
+};
+
+typedef void (*AotBlockFunc)(AotContext &c);
+
+// One recompiled straight-line run of instructions. The original bytes are
+// kept so the host can tell when the ROM has modified the code since.
+struct AotBlock
+{
+	uint16_t start;
+	uint16_t length;	   // in bytes
+	uint16_t instructions; // number of Cycle() calls the block stands for
+	uint8_t const *bytes;
+	AotBlockFunc run;
+};
+
+struct AotProgram
+{
+	uint32_t version;
+	uint32_t machineSize;  // AotContext::MachineSize() when compiled
+	uint32_t fieldOffsets; // AotContext::FieldOffsets() when compiled
+	uint32_t blockCount;
+	AotBlock const *blocks;
+};
+
+// Every plug-in exports this symbol with C linkage
+typedef AotProgram const *(*AotProgramEntry)();
+#define AOT_PROGRAM_ENTRY "mayochip8_aot_program"
+
+// Runs a machine using recompiled blocks where they are valid and
+// Chip8::Step() everywhere else: for addresses without a block, for blocks
+// whose bytes no longer match memory and for blocks longer than the budget.
+class AotBackend
+{
+public:
+	explicit AotBackend(AotProgram const *program);
+
+	unsigned int Step(Chip8 &chip8, unsigned int budget);
+	void Run(Chip8 &chip8, uint64_t cycles);
+
+	uint64_t GetCompiledCycles() const { return compiledCycles; }
+	uint64_t GetInterpretedCycles() const { return interpretedCycles; }
+
+private:
+	AotBlock const *lookup[MEMORY_SIZE]{};
+	uint64_t compiledCycles{};
+	uint64_t interpretedCycles{};
+};
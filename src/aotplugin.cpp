@@ -0,0 +1,26 @@
+#include "aotplugin.hpp"
+#include <dlfcn.h>
+
+AotProgram const *LoadAotPlugin(char const *path)
+{
+	// The handle is intentionally never closed, the blocks live as long as the process
+	void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!handle)
+	{
+		return nullptr;
+	}
+
+	AotProgramEntry entry = reinterpret_cast<AotProgramEntry>(dlsym(handle, AOT_PROGRAM_ENTRY));
+	if (!entry)
+	{
+		return nullptr;
+	}
+
+	AotProgram const *program = entry();
+	if (!program || program->version != AOT_PROGRAM_VERSION || program->machineSize != AotContext::MachineSize() ||
+		program->fieldOffsets != AotContext::FieldOffsets())
+	{
+		return nullptr;
+	}
+	return program;
+}
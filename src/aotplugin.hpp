@@ -0,0 +1,9 @@
+#pragma once
+
+#include "aot.hpp"
+
+// Load a plug-in built from chip8aot output. Returns nullptr if the library
+// cannot be opened, lacks the entry point or was built for another version
+// or another Chip8 layout.
+// Lives outside chip8core so that only the tools that load plug-ins need dlopen.
+AotProgram const *LoadAotPlugin(char const *path);
@@ -0,0 +1,53 @@
+#include "arena.hpp"
+#include <cassert>
+
+Chip8Arena::Chip8Arena(size_t capacity)
+	: capacity(capacity), slots(new Chip8[capacity]), inUse(capacity, false)
+{
+	// Hand out low slots first
+	freeSlots.reserve(capacity);
+	for (size_t i = capacity; i > 0; --i)
+	{
+		freeSlots.push_back(static_cast<uint32_t>(i - 1));
+	}
+}
+
+Chip8 *Chip8Arena::Fork(Chip8 const &source)
+{
+	Chip8 *clone = Acquire();
+	if (clone)
+	{
+		source.Fork(*clone);
+	}
+	return clone;
+}
+
+// A slot comes back with whatever state it was released with; callers that
+// do not fork into it should Reset() it
+Chip8 *Chip8Arena::Acquire()
+{
+	if (freeSlots.empty())
+	{
+		return nullptr;
+	}
+	uint32_t slot = freeSlots.back();
+	freeSlots.pop_back();
+	inUse[slot] = true;
+	return &slots[slot];
+}
+
+bool Chip8Arena::Release(Chip8 *machine)
+{
+	assert(machine >= slots.get() && machine < slots.get() + capacity);
+	size_t slot = static_cast<size_t>(machine - slots.get());
+	if (slot >= capacity || !inUse[slot])
+	{
+		return false;
+	}
+	inUse[slot] = false;
+
+	// Each slot is free at most once and freeSlots has capacity for every
+	// slot, so this never reallocates
+	freeSlots.push_back(static_cast<uint32_t>(slot));
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A fixed pool of machines constructed once up front. Fork() copies the
+// mutable state of a running machine into a free slot, so cloning for tree
+// search costs a few memcpys and no allocation, constructor or RNG seeding.
+class Chip8Arena
+{
+public:
+	explicit Chip8Arena(size_t capacity);
+
+	// Both return nullptr when every slot is in use
+	Chip8 *Fork(Chip8 const &source);
+	Chip8 *Acquire();
+
+	// machine must come from this arena. Releasing a slot that is already
+	// free is rejected and returns false, so it cannot be handed out twice.
+	bool Release(Chip8 *machine);
+
+	size_t GetCapacity() const { return capacity; }
+	size_t GetFreeCount() const { return freeSlots.size(); }
+
+private:
+	size_t capacity;
+	std::unique_ptr<Chip8[]> slots;
+	std::vector<uint32_t> freeSlots;
+	std::vector<bool> inUse;
+};
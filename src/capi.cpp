@@ -0,0 +1,150 @@
+#include "mayochip8.h"
+#include "chip8.hpp"
+#ifdef MAYOCHIP8_STREAM
+#include "stream.hpp"
+#endif
+#include <memory>
+#include <new>
+
+struct mc8_machine
+{
+	Chip8 chip8;
+	mc8_state_view view;
+	uint64_t const *framebuffer;
+	unsigned int cyclesPerFrame;
+#ifdef MAYOCHIP8_STREAM
+	std::unique_ptr<FrameStreamer> streamer;
+#endif
+
+	mc8_machine()
+		: cyclesPerFrame(1)
+	{
+		framebuffer = chip8.video;
+		view.registers = chip8.registers;
+		view.memory = chip8.memory;
+		view.stack = chip8.stack;
+		view.index = &chip8.index;
+		view.pc = &chip8.pc;
+		view.sp = &chip8.sp;
+		view.delay_timer = &chip8.delayTimer;
+		view.sound_timer = &chip8.soundTimer;
+	}
+
+	// The view points into this object's own Chip8
+	mc8_machine(mc8_machine const &) = delete;
+	mc8_machine &operator=(mc8_machine const &) = delete;
+};
+
+unsigned int mc8_api_version(void)
+{
+	return MC8_API_VERSION;
+}
+
+mc8_machine *mc8_create(void)
+{
+	return new (std::nothrow) mc8_machine();
+}
+
+void mc8_destroy(mc8_machine *machine)
+{
+	delete machine;
+}
+
+int mc8_load_rom(mc8_machine *machine, const uint8_t *data, size_t size)
+{
+	if (size > MC8_MAX_ROM_SIZE)
+	{
+		return -1;
+	}
+	machine->chip8.LoadRom(data, size);
+	machine->chip8.Reset();
+	return 0;
+}
+
+void mc8_reset(mc8_machine *machine)
+{
+	machine->chip8.Reset();
+}
+
+void mc8_seed(mc8_machine *machine, uint32_t seed)
+{
+	machine->chip8.SeedRandom(seed);
+}
+
+void mc8_set_cycles_per_frame(mc8_machine *machine, unsigned int cycles)
+{
+	machine->cyclesPerFrame = cycles;
+}
+
+void mc8_step_frames(mc8_machine *machine, unsigned int frames)
+{
+#ifdef MAYOCHIP8_STREAM
+	if (!machine->streamer)
+	{
+		machine->chip8.Run(static_cast<uint64_t>(frames) * machine->cyclesPerFrame);
+		return;
+	}
+
+	for (unsigned int i = 0; i < frames; ++i)
+	{
+		machine->chip8.Run(machine->cyclesPerFrame);
+		machine->streamer->Publish(machine->framebuffer);
+	}
+#else
+	machine->chip8.Run(static_cast<uint64_t>(frames) * machine->cyclesPerFrame);
+#endif
+}
+
+void mc8_set_keys(mc8_machine *machine, uint16_t keys)
+{
+	*machine->chip8.GetKeypad() = keys;
+}
+
+mc8_machine *mc8_fork(const mc8_machine *machine)
+{
+	mc8_machine *clone = new (std::nothrow) mc8_machine();
+	if (clone)
+	{
+		machine->chip8.Fork(clone->chip8);
+		clone->cyclesPerFrame = machine->cyclesPerFrame;
+	}
+	return clone;
+}
+
+int mc8_stream_open(mc8_machine *machine, const char *socket_path)
+{
+#ifdef MAYOCHIP8_STREAM
+	machine->streamer.reset();
+	if (!socket_path)
+	{
+		return 0;
+	}
+
+	std::unique_ptr<FrameStreamer> streamer(new (std::nothrow) FrameStreamer(socket_path));
+	if (!streamer || !streamer->IsOpen())
+	{
+		return -1;
+	}
+	machine->streamer = std::move(streamer);
+	return 0;
+#else
+	// Built without Unix domain sockets; there is never a stream to stop
+	(void)machine;
+	return socket_path ? -1 : 0;
+#endif
+}
+
+const uint64_t *mc8_framebuffer(const mc8_machine *machine)
+{
+	return machine->framebuffer;
+}
+
+const mc8_state_view *mc8_state(const mc8_machine *machine)
+{
+	return &machine->view;
+}
+
+uint64_t mc8_state_hash(const mc8_machine *machine)
+{
+	return machine->chip8.StateHash();
+}
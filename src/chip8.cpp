@@ -1,10 +1,28 @@
 #include "chip8.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include <fstream>
 #include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
 #include <random>
+#include <vector>
 
 const unsigned int START_ADDRESS = 0x200;
 
+static inline unsigned int CountTrailingZeros(uint16_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanForward(&bit, value);
+	return bit;
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
 const unsigned int FONTSET_SIZE = 80; // 16 chars * 5 bytes = size 80 array
 const unsigned int FONTSET_START_ADDRESS = 0x50;
 uint8_t fontset[FONTSET_SIZE] =
@@ -38,7 +56,14 @@ Chip8::Chip8()
 	// Initialize random number generator
 	randByte = std::uniform_int_distribution<uint8_t>(0, 255U);
 
-	SetupFunctionPointerTable();
+	// The tables are shared, only the first machine fills them in
+	static bool const tablesReady = (SetupFunctionPointerTable(), true);
+	(void)tablesReady;
+
+	// Keep a running machine small enough to run millions of them
+	static_assert(offsetof(Chip8, soundTimer) < 64, "hot state must fit in one cache line");
+	static_assert(offsetof(Chip8, stateHash) + sizeof(uint64_t) <= 64, "state hash must share the hot cache line");
+	static_assert(sizeof(Chip8) <= 4608, "Chip8 should stay under 4.5 KB");
 }
 
 void Chip8::LoadRom(char const *filename)
@@ -51,35 +76,95 @@ void Chip8::LoadRom(char const *filename)
 	{
 		// get size of file
 		std::streampos file_size = file.tellg();
-		// allocate buffer to hold file contents
-		char *buffer = new char[file_size];
+		// allocate buffer to hold file contents, kept as the ROM image that
+		// Reset() reloads from and that forked machines share
+		auto image = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(file_size));
 
 		// go back to start of file
 		file.seekg(0, std::ios::beg);
 		// fill buffer with file contents
-		file.read(buffer, file_size);
+		file.read(reinterpret_cast<char *>(image->data()), file_size);
 		file.close();
 
-		// load ROM contents into CHIP-8's memory, starting at 0x200
-		for (long i = 0; i < file_size; ++i)
-		{
-			memory[START_ADDRESS + i] = buffer[i];
-		}
+		LoadRomImage(image);
+	}
+}
+
+void Chip8::LoadRom(uint8_t const *data, size_t size)
+{
+	LoadRomImage(std::make_shared<std::vector<uint8_t>>(data, data + size));
+}
 
-		// free the buffer
-		delete[] buffer;
+void Chip8::LoadRomImage(std::shared_ptr<std::vector<uint8_t> const> image)
+{
+	// load ROM contents into CHIP-8's memory, starting at 0x200
+	romHash = 0;
+	for (size_t i = 0; i < image->size(); ++i)
+	{
+		SetMemory(START_ADDRESS + i, (*image)[i]);
+		romHash ^= HashKey(HASH_SLOT_MEMORY + START_ADDRESS + i, (*image)[i]);
 	}
+
+	romSize = static_cast<uint16_t>(image->size());
+	rom = std::move(image);
+}
+
+// Return to the state right after construction and LoadRom(), without
+// rebuilding the dispatch tables or reseeding the RNG
+void Chip8::Reset()
+{
+	std::memset(registers, 0, sizeof(registers));
+	std::memset(memory, 0, sizeof(memory));
+	std::memset(stack, 0, sizeof(stack));
+	std::memset(video, 0, sizeof(video));
+	keypad = 0;
+	index = 0;
+	sp = 0;
+	delayTimer = 0;
+	soundTimer = 0;
+	pc = START_ADDRESS;
+	stateHash = 0;
+
+	LoadFontset();
+	if (rom)
+	{
+		std::memcpy(&memory[START_ADDRESS], rom->data(), rom->size());
+		stateHash ^= romHash;
+	}
+}
+
+// Copy the mutable machine state into an already constructed machine. The ROM
+// image and the dispatch tables are shared, so nothing is allocated.
+void Chip8::Fork(Chip8 &clone) const
+{
+	std::memcpy(clone.registers, registers, sizeof(registers));
+	std::memcpy(clone.memory, memory, sizeof(memory));
+	std::memcpy(clone.stack, stack, sizeof(stack));
+	std::memcpy(clone.video, video, sizeof(video));
+	clone.keypad = keypad;
+	clone.index = index;
+	clone.pc = pc;
+	clone.sp = sp;
+	clone.delayTimer = delayTimer;
+	clone.soundTimer = soundTimer;
+	clone.opcode = opcode;
+	clone.romSize = romSize;
+	clone.rom = rom;
+	clone.stateHash = stateHash;
+	clone.romHash = romHash;
+	clone.randGen = randGen;
+	clone.randByte = randByte;
 }
 
 void Chip8::LoadFontset() // Load fonts into memory
 {
 	for (unsigned int i = 0; i < FONTSET_SIZE; ++i)
 	{
-		memory[FONTSET_START_ADDRESS + i] = fontset[i];
+		SetMemory(FONTSET_START_ADDRESS + i, fontset[i]);
 	}
 }
 
-void Chip8::Cycle()
+void Chip8::FetchExecute()
 {
 	// Fetch
 	opcode = (memory[pc] << 8u) | memory[pc + 1];
@@ -88,7 +173,12 @@ void Chip8::Cycle()
 	pc += 2;
 
 	// Decode and execute
-	((*this).*(table[(opcode & 0xF000u) >> 12u]))();
+	Execute();
+}
+
+void Chip8::Cycle()
+{
+	FetchExecute();
 
 	// Decrement delay timer if set
 	if (delayTimer > 0)
@@ -103,6 +193,58 @@ void Chip8::Cycle()
 	}
 }
 
+void Chip8::SeedRandom(unsigned int seed)
+{
+	randGen.seed(seed);
+	randByte.reset();
+}
+
+// Compare the architectural state, ignoring the RNG and the last opcode
+bool Chip8::SameState(Chip8 const &other) const
+{
+	return std::memcmp(registers, other.registers, sizeof(registers)) == 0 &&
+		   std::memcmp(memory, other.memory, sizeof(memory)) == 0 &&
+		   std::memcmp(stack, other.stack, sizeof(stack)) == 0 &&
+		   std::memcmp(video, other.video, sizeof(video)) == 0 &&
+		   index == other.index && pc == other.pc && sp == other.sp &&
+		   delayTimer == other.delayTimer && soundTimer == other.soundTimer;
+}
+
+uint64_t Chip8::ComputeStateHash() const
+{
+	uint64_t hash = ScalarKey();
+	for (unsigned int i = 0; i < MEMORY_SIZE; ++i)
+	{
+		hash ^= HashKey(HASH_SLOT_MEMORY + i, memory[i]);
+	}
+	for (unsigned int i = 0; i < STACK_SIZE; ++i)
+	{
+		hash ^= HashKey(HASH_SLOT_STACK + i, stack[i]);
+	}
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		hash ^= RowKey(row, video[row]);
+	}
+	return hash;
+}
+
+void Chip8::RenderVideo(uint32_t *pixels) const
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		for (unsigned int col = 0; col < VIDEO_WIDTH; ++col)
+		{
+			pixels[row * VIDEO_WIDTH + col] = ((video[row] >> (VIDEO_WIDTH - 1 - col)) & 0x1u) ? 0xFFFFFFFF : 0;
+		}
+	}
+}
+
+Chip8::Chip8Func Chip8::table[0xF + 1];
+Chip8::Chip8Func Chip8::table0[0xF + 1];
+Chip8::Chip8Func Chip8::table8[0xF + 1];
+Chip8::Chip8Func Chip8::tableE[0xF + 1];
+Chip8::Chip8Func Chip8::tableF[0xFF + 1];
+
 void Chip8::SetupFunctionPointerTable()
 {
 	table[0x0] = &Chip8::Table0;
@@ -122,7 +264,7 @@ void Chip8::SetupFunctionPointerTable()
 	table[0xE] = &Chip8::TableE;
 	table[0xF] = &Chip8::TableF;
 
-	for (size_t i = 0; i <= 0xE; i++)
+	for (size_t i = 0; i <= 0xF; i++)
 	{
 		table0[i] = &Chip8::OP_NULL;
 		table8[i] = &Chip8::OP_NULL;
@@ -149,7 +291,7 @@ void Chip8::SetupFunctionPointerTable()
 	tableE[0xE] = &Chip8::OP_Ex9E;
 
 	// Table F function pointers
-	for (size_t i = 0; i <= 0x65; i++)
+	for (size_t i = 0; i <= 0xFF; i++)
 	{
 		tableF[i] = &Chip8::OP_NULL;
 	}
@@ -164,6 +306,11 @@ void Chip8::SetupFunctionPointerTable()
 	tableF[0x65] = &Chip8::OP_Fx65;
 }
 
+void Chip8::Execute()
+{
+	((*this).*(table[(opcode & 0xF000u) >> 12u]))();
+}
+
 // The first three digits are $00E but the fourth digit is unique
 void Chip8::Table0()
 {
@@ -196,7 +343,10 @@ void Chip8::OP_NULL()
 void Chip8::OP_00E0() // Clear the display
 {
 	// Set entire video buffer to 0
-	memset(video, 0, sizeof(video));
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		SetVideoRow(row, 0);
+	}
 }
 
 void Chip8::OP_00EE() // Return from a subroutine
@@ -212,7 +362,7 @@ void Chip8::OP_1nnn() // Jump to location nnn
 
 void Chip8::OP_2nnn() // Call subroutine at nnn
 {
-	stack[sp] = pc; // Current pc holds next instruction after CALL due to pc += 2, which is correct
+	SetStack(sp, pc); // Current pc holds next instruction after CALL due to pc += 2, which is correct
 	++sp;
 	pc = opcode & 0x0FFFu;
 }
@@ -254,42 +404,42 @@ void Chip8::OP_6xkk() // Set Vx = kk
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t byte = opcode & 0x00FFu;
-	registers[Vx] = byte;
+	SetRegister(Vx, byte);
 }
 
 void Chip8::OP_7xkk() // Set Vx = Vx + kk
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t byte = opcode & 0x00FFu;
-	registers[Vx] += byte;
+	SetRegister(Vx, registers[Vx] + byte);
 }
 
 void Chip8::OP_8xy0() // Set Vx = Vy
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-	registers[Vx] = registers[Vy];
+	SetRegister(Vx, registers[Vy]);
 }
 
 void Chip8::OP_8xy1() // Set Vx OR Vy
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-	registers[Vx] |= registers[Vy];
+	SetRegister(Vx, registers[Vx] | registers[Vy]);
 }
 
 void Chip8::OP_8xy2() // Set Vx AND Vy
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-	registers[Vx] &= registers[Vy];
+	SetRegister(Vx, registers[Vx] & registers[Vy]);
 }
 
 void Chip8::OP_8xy3() // Set Vx XOR Vy
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-	registers[Vx] ^= registers[Vy];
+	SetRegister(Vx, registers[Vx] ^ registers[Vy]);
 }
 
 void Chip8::OP_8xy4() // Set Vx = Vx + Vy, set VF = carry
@@ -300,14 +450,14 @@ void Chip8::OP_8xy4() // Set Vx = Vx + Vy, set VF = carry
 
 	if (sum > 255U)
 	{
-		registers[0xF] = 1;
+		SetRegister(0xF, 1);
 	}
 	else
 	{
-		registers[0xF] = 0;
+		SetRegister(0xF, 0);
 	}
 
-	registers[Vx] = sum & 0xFF;
+	SetRegister(Vx, sum & 0xFF);
 }
 
 void Chip8::OP_8xy5() // Set Vx = Vx - Vy, set VF = NOT borrow
@@ -317,14 +467,14 @@ void Chip8::OP_8xy5() // Set Vx = Vx - Vy, set VF = NOT borrow
 	// If Vx > Vy, VF is set to 1, otherwise 0.
 	if (registers[Vx] > registers[Vy])
 	{
-		registers[0xF] = 1;
+		SetRegister(0xF, 1);
 	}
 	else
 	{
-		registers[0xF] = 0;
+		SetRegister(0xF, 0);
 	}
 
-	registers[Vx] -= registers[Vy];
+	SetRegister(Vx, registers[Vx] - registers[Vy]);
 }
 
 void Chip8::OP_8xy6() // Set Vx = Vx SHR 1
@@ -332,8 +482,8 @@ void Chip8::OP_8xy6() // Set Vx = Vx SHR 1
 	// If LSB of Vx is 1, VF is 1, otherwise 0. Then Vx is divided by 2.
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	// Save LSB in VF
-	registers[0xF] = registers[Vx] & 0x1u;
-	registers[Vx] >>= 1; // Shift right by 1
+	SetRegister(0xF, registers[Vx] & 0x1u);
+	SetRegister(Vx, registers[Vx] >> 1); // Shift right by 1
 }
 
 void Chip8::OP_8xy7() // Set Vx = Vy - Vx, set VF = NOT borrow
@@ -343,22 +493,22 @@ void Chip8::OP_8xy7() // Set Vx = Vy - Vx, set VF = NOT borrow
 
 	if (registers[Vy] > registers[Vx])
 	{
-		registers[0xF] = 1;
+		SetRegister(0xF, 1);
 	}
 	else
 	{
-		registers[0xF] = 0;
+		SetRegister(0xF, 0);
 	}
 
-	registers[Vx] = registers[Vy] - registers[Vx];
+	SetRegister(Vx, registers[Vy] - registers[Vx]);
 }
 
 void Chip8::OP_8xyE() // Set Vx = Vx SHL 1
 {
 	// If MSB of Vx is 1, then VF = 1, otherwise 0. Then Vx * 2
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	registers[0xF] = (registers[Vx] & 0x80u) >> 7u;
-	registers[Vx] <<= 1; // Shift left by 1
+	SetRegister(0xF, (registers[Vx] & 0x80u) >> 7u);
+	SetRegister(Vx, registers[Vx] << 1); // Shift left by 1
 }
 
 void Chip8::OP_9xy0() // Skip next instruction is Vx != Vy
@@ -388,7 +538,7 @@ void Chip8::OP_Cxkk() // Set Vx = random byte AND kk
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t byte = opcode & 0x00FFu;
-	registers[Vx] = randByte(randGen) & byte;
+	SetRegister(Vx, randByte(randGen) & byte);
 }
 
 void Chip8::OP_Dxyn() // Display n-byte sprite starting at memory location I,
@@ -400,44 +550,51 @@ void Chip8::OP_Dxyn() // Display n-byte sprite starting at memory location I,
 	// Wrap if going beyond screen boundaries
 	uint8_t xPos = registers[Vx] % VIDEO_WIDTH;
 	uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
-	// Reset register VF to 0, used as a collision flag
-	registers[0xF] = 0;
+	// Collision flag for VF, written once the sprite is drawn
+	uint8_t collision = 0;
 
 	// Iterate through all rows for specified height n
 	for (unsigned int row = 0; row < height; ++row)
 	{
-		uint8_t spriteByte = memory[index + row];
-		// Iterate through columns
-		for (unsigned int col = 0; col < 8; ++col)
+		uint64_t spriteByte = memory[index + row];
+		unsigned int screenRow = yPos + row;
+		if (screenRow >= VIDEO_HEIGHT)
 		{
-			// 0x80 is binary 10000000. Shifting it right by col places the 1 at
-			// the desired bit position. The bitwise AND operation (&) isolates
-			// that single sprite pixel.
-			uint8_t spritePixel = spriteByte & (0x80u >> col);
-			// Calculates the exact memory address in the video buffer (your SDL
-			// pixel buffer) that corresponds to the screen pixel being drawn to.
-			uint32_t *screenPixelPointer = &video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
-
-			// Check if sprite pixel is on
-			if (spritePixel)
+			break;
+		}
+
+		// Line the sprite byte up with xPos in a 64-bit row, where the
+		// leftmost pixel is the most significant bit. Pixels that run past
+		// the right edge continue at the start of the next row, the same
+		// place the old one-word-per-pixel buffer put them.
+		uint64_t rowPixels = (spriteByte << 56u) >> xPos;
+		uint64_t spillPixels = xPos > 56u ? spriteByte << (120u - xPos) : 0;
+
+		// Any sprite pixel landing on a lit pixel is a collision
+		if (video[screenRow] & rowPixels)
+		{
+			collision = 1; // Set collision flag to 1
+		}
+		// XOR with sprite pixels
+		SetVideoRow(screenRow, video[screenRow] ^ rowPixels);
+
+		if (spillPixels && screenRow + 1 < VIDEO_HEIGHT)
+		{
+			if (video[screenRow + 1] & spillPixels)
 			{
-				// Check if screen pixel is also on - collision
-				if (*screenPixelPointer == 0xFFFFFFFF)
-				{
-					registers[0xF] = 1; // Set collision flag to 1
-				}
-				// XOR with sprite pixel
-				*screenPixelPointer ^= 0xFFFFFFFF;
+				collision = 1;
 			}
+			SetVideoRow(screenRow + 1, video[screenRow + 1] ^ spillPixels);
 		}
 	}
+	SetRegister(0xF, collision);
 }
 
 void Chip8::OP_Ex9E() // Skip next instruction if key with value of Vx is pressed
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t key = registers[Vx];
-	if (keypad[key])
+	if (key < KEYPAD_KEY_COUNT && ((keypad >> key) & 0x1u))
 	{
 		pc += 2;
 	}
@@ -447,7 +604,7 @@ void Chip8::OP_ExA1() // Skip next instruction if key with the value of Vx is no
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	uint8_t key = registers[Vx];
-	if (!keypad[key])
+	if (!(key < KEYPAD_KEY_COUNT && ((keypad >> key) & 0x1u)))
 	{
 		pc += 2;
 	}
@@ -456,23 +613,18 @@ void Chip8::OP_ExA1() // Skip next instruction if key with the value of Vx is no
 void Chip8::OP_Fx07() // Set Vx = delay timer value
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	registers[Vx] = delayTimer;
+	SetRegister(Vx, delayTimer);
 }
 
 void Chip8::OP_Fx0A() // Wait for a key press, store value of key in Vx
 {
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	bool keyPressDetected = false;
-	for (int i = 0; i < 16; i++)
+	if (keypad)
 	{
-		if (keypad[i])
-		{
-			registers[Vx] = i;
-			keyPressDetected = true;
-			break; // Exit the loop immediately once a key is found
-		}
+		// The lowest pressed key wins, as with the old scan from key 0 up
+		SetRegister(Vx, CountTrailingZeros(keypad));
 	}
-	if (!keyPressDetected)
+	else
 	{
 		// No key pressed this cycle, so execute the wait by decrementing the PC.
 		// This ensures the same instruction is fetched and executed again next cycle.
@@ -516,13 +668,13 @@ void Chip8::OP_Fx33() // Store BCD representation of Vx in memory locations
 	// the ones digit at location I+2.
 
 	// Ones place
-	memory[index + 2] = number % 10;
+	SetMemory(index + 2, number % 10);
 	number /= 10;
 	// Tens place
-	memory[index + 1] = number % 10;
+	SetMemory(index + 1, number % 10);
 	number /= 10;
 	// Hundreds place
-	memory[index] = number % 10;
+	SetMemory(index, number % 10);
 	// By extracting the digit at the specific position and storing in the
 	// memory location, we directly end up storing the digits in BCD as a result
 }
@@ -532,7 +684,7 @@ void Chip8::OP_Fx55() // Store registers V0 through Vx in memory, starting at lo
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	for (uint8_t i = 0; i <= Vx; ++i)
 	{
-		memory[index + i] = registers[i];
+		SetMemory(index + i, registers[i]);
 	}
 }
 
@@ -541,6 +693,6 @@ void Chip8::OP_Fx65() // Read registers V0 through Vx in memory, starting at loc
 	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 	for (uint8_t i = 0; i <= Vx; ++i)
 	{
-		registers[i] = memory[index + i];
+		SetRegister(i, memory[index + i]);
 	}
 }
\ No newline at end of file
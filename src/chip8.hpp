@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <random>
+#include <vector>
 
 const unsigned int REGISTER_COUNT = 16;
 const unsigned int KEYPAD_KEY_COUNT = 16;
@@ -12,40 +16,165 @@ const unsigned int VIDEO_WIDTH = 64;
 
 class Chip8
 {
+	friend class Debugger;
+	friend class AotContext;
+	friend class LockstepHarness;
+	friend class FuzzExecutor;
+	friend class VipTiming;
+	friend struct mc8_machine;
+
 public:
 	Chip8();
 	void LoadRom(char const *filename);
+	void LoadRom(uint8_t const *data, size_t size);
+	void Reset();
+	void Fork(Chip8 &clone) const;
 	void LoadFontset();
-	void SetupFunctionPointerTable();
+	static void SetupFunctionPointerTable();
 	void Cycle();
-	
-	// Getters for main.cpp
-	uint8_t *GetKeypad() { return keypad; }
-	uint32_t *GetVideo() { return video; }
+	unsigned int Step(unsigned int budget);
+	void Run(uint64_t cycles);
+	void SeedRandom(unsigned int seed);
+	bool SameState(Chip8 const &other) const;
+
+	// 64-bit Zobrist hash of the state SameState() compares. Memory, stack
+	// and video are kept up to date on every write; the registers, pc, I, sp
+	// and the timers change nearly every cycle, so they are folded in here.
+	uint64_t StateHash() const { return stateHash ^ ScalarKey(); }
+	// The same hash computed from scratch, for checking StateHash()
+	uint64_t ComputeStateHash() const;
+
+	// Getters for main.cpp. Bit n of the keypad is key n. Each video row is
+	// one word with the leftmost pixel in the most significant bit.
+	uint16_t *GetKeypad() { return &keypad; }
+	uint64_t const *GetVideo() const { return video; }
+	void RenderVideo(uint32_t *pixels) const;
+	uint8_t const *GetMemory() const { return memory; }
+	uint16_t GetRomSize() const { return romSize; }
 
 private:
-	uint8_t registers[REGISTER_COUNT]{};
-	uint8_t memory[MEMORY_SIZE]{};
+	// Everything the hot loop touches shares the first cache line, including
+	// the state hash that memory, stack and video writes update. Only the two
+	// deepest stack slots spill into the next line.
+	alignas(64) uint8_t registers[REGISTER_COUNT]{};
+	uint64_t stateHash{};
 	uint16_t index{};
 	uint16_t pc{};
-	uint16_t stack[STACK_SIZE]{};
+	uint16_t opcode{};
+	uint16_t keypad{};
 	uint8_t sp{};
 	uint8_t delayTimer{};
 	uint8_t soundTimer{};
-	uint8_t keypad[KEYPAD_KEY_COUNT]{};
-	uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};
-	uint16_t opcode;
+	uint16_t stack[STACK_SIZE]{};
+
+	uint8_t memory[MEMORY_SIZE]{};
+	uint64_t video[VIDEO_HEIGHT]{};
+	uint16_t romSize{};
+	std::shared_ptr<std::vector<uint8_t> const> rom;
+
+	// Zobrist keys are computed rather than tabled, since a table for all of
+	// memory would be 8 MB. A zero byte, word or row has key 0, so a cleared
+	// machine hashes to 0 and only non-zero contents need hashing in.
+	uint64_t romHash{}; // what the ROM image adds at START_ADDRESS, for Reset()
+
+	static const unsigned int HASH_SLOT_MEMORY = REGISTER_COUNT;
+	static const unsigned int HASH_SLOT_STACK = HASH_SLOT_MEMORY + MEMORY_SIZE;
+
+	static uint64_t HashMix(uint64_t value)
+	{
+		value = (value ^ (value >> 30u)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27u)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31u);
+	}
+	static uint64_t HashKey(unsigned int slot, uint16_t value)
+	{
+		return value ? HashMix(static_cast<uint64_t>(slot) << 16u | value) : 0;
+	}
+	static uint64_t RowKey(unsigned int row, uint64_t value)
+	{
+		return value ? HashMix(value + (row + 1) * 0x9E3779B97F4A7C15ull) : 0;
+	}
+	// Hashing the 16 registers as two words here costs two HashMix() calls
+	// per StateHash(), where keeping them incremental cost two per write
+	uint64_t ScalarKey() const
+	{
+		uint64_t low;
+		uint64_t high;
+		std::memcpy(&low, registers, sizeof(low));
+		std::memcpy(&high, registers + sizeof(low), sizeof(high));
+		return HashMix(1ull << 63u | index | static_cast<uint64_t>(pc) << 16u | static_cast<uint64_t>(sp) << 32u |
+					   static_cast<uint64_t>(delayTimer) << 40u | static_cast<uint64_t>(soundTimer) << 48u) ^
+			   HashMix(low + 0x9E3779B97F4A7C15ull * (VIDEO_HEIGHT + 1)) ^
+			   HashMix(high + 0x9E3779B97F4A7C15ull * (VIDEO_HEIGHT + 2));
+	}
 
-	std::default_random_engine randGen;
+	// Every handler writes registers, memory, the stack and video through these
+	void SetRegister(unsigned int x, uint8_t value)
+	{
+		registers[x] = value;
+	}
+	void SetMemory(unsigned int address, uint8_t value)
+	{
+		stateHash ^= HashKey(HASH_SLOT_MEMORY + address, memory[address]) ^ HashKey(HASH_SLOT_MEMORY + address, value);
+		memory[address] = value;
+	}
+	void SetStack(unsigned int slot, uint16_t value)
+	{
+		stateHash ^= HashKey(HASH_SLOT_STACK + slot, stack[slot]) ^ HashKey(HASH_SLOT_STACK + slot, value);
+		stack[slot] = value;
+	}
+	void SetVideoRow(unsigned int row, uint64_t value)
+	{
+		// Blank sprite rows and clearing an empty screen leave rows as they
+		// are; skipping them saves two HashMix() calls per row
+		if (value == video[row])
+		{
+			return;
+		}
+		stateHash ^= RowKey(row, video[row]) ^ RowKey(row, value);
+		video[row] = value;
+	}
+
+	// minstd_rand0 is what libstdc++ and libc++ use for default_random_engine;
+	// naming it keeps the state to one word on every standard library
+	std::minstd_rand0 randGen;
 	std::uniform_int_distribution<uint8_t> randByte;
 
+	// Shared by every instance, filled once by SetupFunctionPointerTable()
 	typedef void (Chip8::*Chip8Func)();
-	Chip8Func table[0xF + 1];
-	Chip8Func table0[0xE + 1];
-	Chip8Func table8[0xE + 1];
-	Chip8Func tableE[0xE + 1];
-	Chip8Func tableF[0x65 + 1];
+	static Chip8Func table[0xF + 1];
+	static Chip8Func table0[0xF + 1];
+	static Chip8Func table8[0xF + 1];
+	static Chip8Func tableE[0xF + 1];
+	static Chip8Func tableF[0xFF + 1];
+
+	// Superinstructions, see fusion.cpp. A handler runs a whole matched
+	// sequence and returns the number of cycles it stands for, or 0 to
+	// decline so the next rule is tried.
+	typedef unsigned int (Chip8::*FusedFunc)(uint16_t const *opcodes);
+	static const unsigned int FUSION_MAX_LENGTH = 3;
+	struct FusionRule
+	{
+		unsigned int length;
+		uint16_t mask[FUSION_MAX_LENGTH];
+		uint16_t match[FUSION_MAX_LENGTH];
+		FusedFunc handler;
+	};
+	static FusionRule fusionRules[];
+	static uint8_t fusionOffsets[0xF + 2];
+	static bool const fusionIndexed;
+	static bool IndexFusionRules();
+
+	void TickTimers(unsigned int cycles);
+	unsigned int FUSE_6xkk_6xkk_Dxyn(uint16_t const *opcodes);
+	unsigned int FUSE_Fx07_3xkk_1nnn(uint16_t const *opcodes);
+	unsigned int FUSE_3xkk_1nnn(uint16_t const *opcodes);
+	unsigned int FUSE_4xkk_1nnn(uint16_t const *opcodes);
+	unsigned int FUSE_Annn_Fx65(uint16_t const *opcodes);
 
+	void LoadRomImage(std::shared_ptr<std::vector<uint8_t> const> image);
+	void FetchExecute(); // one instruction, without touching the timers
+	void Execute();
 	void Table0();
 	void Table8();
 	void TableE();
@@ -0,0 +1,291 @@
+#include "debugger.hpp"
+#include <cstring>
+#include <iomanip>
+
+Debugger::Debugger(Chip8 &chip8)
+	: chip8(chip8)
+{
+}
+
+void Debugger::AddBreakpoint(uint16_t address)
+{
+	breakpoints.set(address % MEMORY_SIZE);
+}
+
+void Debugger::RemoveBreakpoint(uint16_t address)
+{
+	breakpoints.reset(address % MEMORY_SIZE);
+}
+
+void Debugger::AddWatchpoint(uint16_t address, uint16_t length, WatchKind kind)
+{
+	for (unsigned int i = address; i < address + length && i < MEMORY_SIZE; ++i)
+	{
+		if (kind != WatchKind::Write)
+		{
+			readWatch.set(i);
+		}
+		if (kind != WatchKind::Read)
+		{
+			writeWatch.set(i);
+		}
+	}
+	watchArmed = readWatch.any() || writeWatch.any();
+}
+
+void Debugger::RemoveWatchpoint(uint16_t address, uint16_t length, WatchKind kind)
+{
+	for (unsigned int i = address; i < address + length && i < MEMORY_SIZE; ++i)
+	{
+		if (kind != WatchKind::Write)
+		{
+			readWatch.reset(i);
+		}
+		if (kind != WatchKind::Read)
+		{
+			writeWatch.reset(i);
+		}
+	}
+	watchArmed = readWatch.any() || writeWatch.any();
+}
+
+void Debugger::AddRegisterCondition(RegisterCondition condition)
+{
+	condition.reg &= 0xFu;
+	conditions.push_back(condition);
+}
+
+void Debugger::ClearRegisterConditions()
+{
+	conditions.clear();
+}
+
+void Debugger::ClearAll()
+{
+	breakpoints.reset();
+	readWatch.reset();
+	writeWatch.reset();
+	conditions.clear();
+	watchArmed = false;
+}
+
+void Debugger::SetInput(std::vector<InputEvent> events)
+{
+	input = std::move(events);
+	nextInput = 0;
+	cycles = 0;
+}
+
+uint16_t Debugger::PeekOpcode() const
+{
+	return (chip8.memory[chip8.pc % MEMORY_SIZE] << 8u) | chip8.memory[(chip8.pc + 1) % MEMORY_SIZE];
+}
+
+// Work out which bytes of memory the opcode is about to touch, using the
+// machine state before it executes. Instruction fetches are not data accesses.
+StopReason Debugger::CheckWatchpoints(uint16_t opcode)
+{
+	uint8_t x = (opcode & 0x0F00u) >> 8u;
+	uint16_t start = chip8.index;
+	unsigned int length = 0;
+	bool isWrite = false;
+
+	if ((opcode & 0xF000u) == 0xD000u) // DRW reads n sprite bytes from I
+	{
+		length = opcode & 0x000Fu;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF033u) // BCD writes I..I+2
+	{
+		length = 3;
+		isWrite = true;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF055u) // Store writes I..I+x
+	{
+		length = x + 1;
+		isWrite = true;
+	}
+	else if ((opcode & 0xF0FFu) == 0xF065u) // Load reads I..I+x
+	{
+		length = x + 1;
+	}
+
+	std::bitset<MEMORY_SIZE> const &watch = isWrite ? writeWatch : readWatch;
+	for (unsigned int i = start; i < start + length && i < MEMORY_SIZE; ++i)
+	{
+		if (watch.test(i))
+		{
+			watchAddress = i;
+			return isWrite ? StopReason::WriteWatchpoint : StopReason::ReadWatchpoint;
+		}
+	}
+	return StopReason::None;
+}
+
+bool Debugger::CheckConditions(uint8_t const *before) const
+{
+	for (RegisterCondition const &condition : conditions)
+	{
+		uint8_t oldValue = before[condition.reg];
+		uint8_t newValue = chip8.registers[condition.reg];
+		switch (condition.compare)
+		{
+		case RegisterCompare::Changed:
+			if (newValue != oldValue)
+			{
+				return true;
+			}
+			break;
+		case RegisterCompare::Equal:
+			// Only fire on the transition, otherwise every later step would stop
+			if (newValue == condition.value && oldValue != condition.value)
+			{
+				return true;
+			}
+			break;
+		case RegisterCompare::NotEqual:
+			if (newValue != condition.value && oldValue == condition.value)
+			{
+				return true;
+			}
+			break;
+		}
+	}
+	return false;
+}
+
+// Execute one instruction. Breakpoints and watchpoints stop before the
+// instruction runs; checkStops is false for the first instruction after a
+// stop so that resuming does not immediately trigger the same stop again.
+StopReason Debugger::CheckedStep(bool checkStops)
+{
+	if (checkStops)
+	{
+		if (breakpoints.test(chip8.pc % MEMORY_SIZE))
+		{
+			return StopReason::Breakpoint;
+		}
+		if (watchArmed)
+		{
+			StopReason reason = CheckWatchpoints(PeekOpcode());
+			if (reason != StopReason::None)
+			{
+				return reason;
+			}
+		}
+	}
+
+	if (conditions.empty())
+	{
+		Execute();
+		return StopReason::None;
+	}
+
+	uint8_t before[REGISTER_COUNT];
+	std::memcpy(before, chip8.registers, sizeof(before));
+	Execute();
+	return CheckConditions(before) ? StopReason::RegisterCondition : StopReason::None;
+}
+
+void Debugger::Execute()
+{
+	while (nextInput < input.size() && input[nextInput].cycle <= cycles)
+	{
+		*chip8.GetKeypad() = input[nextInput].keys;
+		++nextInput;
+	}
+	chip8.Cycle();
+	++cycles;
+}
+
+StopReason Debugger::Step()
+{
+	StopReason reason = CheckedStep(false);
+	return reason == StopReason::None ? StopReason::StepComplete : reason;
+}
+
+// Step over a CALL by running until the matching RET lands back on the
+// instruction after it, at the same stack depth
+StopReason Debugger::StepOver(uint64_t maxCycles)
+{
+	if ((PeekOpcode() & 0xF000u) != 0x2000u)
+	{
+		return Step();
+	}
+
+	uint16_t returnAddress = chip8.pc + 2;
+	uint8_t depth = chip8.sp;
+
+	StopReason reason = CheckedStep(false);
+	for (uint64_t i = 1; reason == StopReason::None; ++i)
+	{
+		if (chip8.pc == returnAddress && chip8.sp == depth)
+		{
+			return StopReason::StepComplete;
+		}
+		if (i >= maxCycles)
+		{
+			return StopReason::CycleLimit;
+		}
+		reason = CheckedStep(true);
+	}
+	return reason;
+}
+
+StopReason Debugger::Continue(uint64_t maxCycles)
+{
+	for (uint64_t i = 0; i < maxCycles; ++i)
+	{
+		StopReason reason = CheckedStep(i != 0);
+		if (reason != StopReason::None)
+		{
+			return reason;
+		}
+	}
+	return StopReason::CycleLimit;
+}
+
+void Debugger::PrintRegisters(std::ostream &out) const
+{
+	std::ios_base::fmtflags flags = out.flags();
+	char fill = out.fill();
+	out << std::hex << std::uppercase << std::setfill('0');
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i)
+	{
+		out << 'V' << std::setw(1) << i << '=' << std::setw(2) << static_cast<unsigned int>(chip8.registers[i])
+			<< ((i % 8 == 7) ? '\n' : ' ');
+	}
+	out << "PC=" << std::setw(3) << chip8.pc << '\n';
+	out.flags(flags);
+	out.fill(fill);
+}
+
+void Debugger::PrintStack(std::ostream &out) const
+{
+	std::ios_base::fmtflags flags = out.flags();
+	char fill = out.fill();
+	out << "SP=" << static_cast<unsigned int>(chip8.sp) << '\n';
+	out << std::hex << std::uppercase << std::setfill('0');
+	// Print the most recent return address first
+	for (unsigned int i = chip8.sp; i > 0 && i <= STACK_SIZE; --i)
+	{
+		out << "  [" << std::setw(1) << (i - 1) << "] " << std::setw(3) << chip8.stack[i - 1] << '\n';
+	}
+	out.flags(flags);
+	out.fill(fill);
+}
+
+void Debugger::PrintIndex(std::ostream &out) const
+{
+	std::ios_base::fmtflags flags = out.flags();
+	char fill = out.fill();
+	out << std::hex << std::uppercase << std::setfill('0');
+	out << "I=" << std::setw(3) << chip8.index << '\n';
+	out.flags(flags);
+	out.fill(fill);
+}
+
+void Debugger::PrintTimers(std::ostream &out) const
+{
+	out << "DT=" << static_cast<unsigned int>(chip8.delayTimer)
+		<< " ST=" << static_cast<unsigned int>(chip8.soundTimer) << '\n';
+}
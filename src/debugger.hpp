@@ -0,0 +1,96 @@
+#pragma once
+
+#include "chip8.hpp"
+#include "lockstep.hpp"
+#include <bitset>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+enum class StopReason
+{
+	None,
+	Breakpoint,
+	ReadWatchpoint,
+	WriteWatchpoint,
+	RegisterCondition,
+	StepComplete,
+	CycleLimit
+};
+
+enum class WatchKind
+{
+	Read,
+	Write,
+	ReadWrite
+};
+
+enum class RegisterCompare
+{
+	Changed,  // Vx differs from its value before the instruction
+	Equal,	  // Vx became equal to value
+	NotEqual  // Vx became different from value
+};
+
+struct RegisterCondition
+{
+	uint8_t reg;
+	RegisterCompare compare;
+	uint8_t value;
+};
+
+// The debugger drives the machine through its own checked run loop instead of
+// hooking Chip8::Cycle(), so a build that never creates a Debugger runs the
+// exact same hot loop as before. Memory watchpoints are resolved by decoding
+// the next opcode before it executes rather than by instrumenting the handlers.
+class Debugger
+{
+public:
+	explicit Debugger(Chip8 &chip8);
+
+	void AddBreakpoint(uint16_t address);
+	void RemoveBreakpoint(uint16_t address);
+	void AddWatchpoint(uint16_t address, uint16_t length, WatchKind kind);
+	void RemoveWatchpoint(uint16_t address, uint16_t length, WatchKind kind);
+	void AddRegisterCondition(RegisterCondition condition);
+	void ClearRegisterConditions();
+	void ClearAll();
+
+	// Replay an input script (see LoadInputScript), with event cycles counted
+	// from when the script is set. Keys change before the instruction at that
+	// cycle runs, the same as in chip8diff and chip8fuzz.
+	void SetInput(std::vector<InputEvent> events);
+	uint64_t GetCycles() const { return cycles; }
+
+	StopReason Step();
+	StopReason StepOver(uint64_t maxCycles);
+	StopReason Continue(uint64_t maxCycles);
+
+	// Address that triggered the last watchpoint stop
+	uint16_t GetWatchAddress() const { return watchAddress; }
+	uint16_t GetPc() const { return chip8.pc; }
+
+	void PrintRegisters(std::ostream &out) const;
+	void PrintStack(std::ostream &out) const;
+	void PrintIndex(std::ostream &out) const;
+	void PrintTimers(std::ostream &out) const;
+
+private:
+	Chip8 &chip8;
+
+	std::bitset<MEMORY_SIZE> breakpoints;
+	std::bitset<MEMORY_SIZE> readWatch;
+	std::bitset<MEMORY_SIZE> writeWatch;
+	std::vector<RegisterCondition> conditions;
+	bool watchArmed{};
+	uint16_t watchAddress{};
+	std::vector<InputEvent> input;
+	size_t nextInput{};
+	uint64_t cycles{};
+
+	uint16_t PeekOpcode() const;
+	StopReason CheckWatchpoints(uint16_t opcode);
+	bool CheckConditions(uint8_t const *before) const;
+	StopReason CheckedStep(bool checkStops);
+	void Execute();
+};
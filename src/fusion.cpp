@@ -0,0 +1,192 @@
+#include "chip8.hpp"
+#include <algorithm>
+
+// Sequences that show up over and over in profiles, each executed by a single
+// handler. Rules are tried in order, so longer sequences that share a prefix
+// with a shorter one must come first. To add a sequence seen in profiling
+// data, add a row here and a FUSE_ handler with the same effects as running
+// the instructions one Cycle() at a time. The first opcode of every rule must
+// match on its whole top nibble.
+Chip8::FusionRule Chip8::fusionRules[] =
+	{
+		// Delay timer poll: LD Vx, DT / SE Vx, kk / JP back
+		{3, {0xF0FFu, 0xF000u, 0xF000u}, {0xF007u, 0x3000u, 0x1000u}, &Chip8::FUSE_Fx07_3xkk_1nnn},
+		// Sprite setup: LD Vx, kk / LD Vy, kk / DRW
+		{3, {0xF000u, 0xF000u, 0xF000u}, {0x6000u, 0x6000u, 0xD000u}, &Chip8::FUSE_6xkk_6xkk_Dxyn},
+		// Conditional jumps
+		{2, {0xF000u, 0xF000u}, {0x3000u, 0x1000u}, &Chip8::FUSE_3xkk_1nnn},
+		{2, {0xF000u, 0xF000u}, {0x4000u, 0x1000u}, &Chip8::FUSE_4xkk_1nnn},
+		// Table loads: LD I, addr / LD Vx, [I]
+		{2, {0xF000u, 0xF0FFu}, {0xA000u, 0xF065u}, &Chip8::FUSE_Annn_Fx65},
+		{0, {}, {}, nullptr}};
+
+uint8_t Chip8::fusionOffsets[0xF + 2];
+
+// Group the rules by the top nibble of their first opcode, keeping table order
+// within a group, so Step() only looks at rules that can match
+bool Chip8::IndexFusionRules()
+{
+	FusionRule *end = fusionRules;
+	while (end->length > 0)
+	{
+		++end;
+	}
+
+	std::stable_sort(fusionRules, end, [](FusionRule const &a, FusionRule const &b)
+					 { return (a.match[0] >> 12u) < (b.match[0] >> 12u); });
+
+	unsigned int rule = 0;
+	for (unsigned int nibble = 0; nibble <= 0xF + 1; ++nibble)
+	{
+		while (fusionRules + rule < end && (fusionRules[rule].match[0] >> 12u) < nibble)
+		{
+			++rule;
+		}
+		fusionOffsets[nibble] = static_cast<uint8_t>(rule);
+	}
+	return true;
+}
+
+bool const Chip8::fusionIndexed = Chip8::IndexFusionRules();
+
+// Execute one instruction, or one fused sequence of at most budget
+// instructions, and return how many Cycle() calls that stood for
+unsigned int Chip8::Step(unsigned int budget)
+{
+	uint16_t opcodes[FUSION_MAX_LENGTH];
+	opcodes[0] = (memory[pc] << 8u) | memory[pc + 1];
+
+	unsigned int nibble = opcodes[0] >> 12u;
+	unsigned int available = (MEMORY_SIZE - pc) / 2;
+	available = available < budget ? available : budget;
+	unsigned int fetched = 1;
+
+	for (unsigned int i = fusionOffsets[nibble]; i < fusionOffsets[nibble + 1]; ++i)
+	{
+		FusionRule const &rule = fusionRules[i];
+		if (rule.length > available || (opcodes[0] & rule.mask[0]) != rule.match[0])
+		{
+			continue;
+		}
+
+		bool matched = true;
+		for (unsigned int k = 1; k < rule.length && matched; ++k)
+		{
+			if (k >= fetched)
+			{
+				opcodes[k] = (memory[pc + 2 * k] << 8u) | memory[pc + 2 * k + 1];
+				fetched = k + 1;
+			}
+			matched = (opcodes[k] & rule.mask[k]) == rule.match[k];
+		}
+
+		if (matched)
+		{
+			unsigned int cycles = ((*this).*(rule.handler))(opcodes);
+			if (cycles > 0)
+			{
+				return cycles;
+			}
+		}
+	}
+
+	Cycle();
+	return 1;
+}
+
+void Chip8::Run(uint64_t cycles)
+{
+	while (cycles >= FUSION_MAX_LENGTH)
+	{
+		cycles -= Step(FUSION_MAX_LENGTH);
+	}
+	while (cycles > 0)
+	{
+		cycles -= Step(static_cast<unsigned int>(cycles));
+	}
+}
+
+// Same as the timer decrements at the end of that many Cycle() calls
+void Chip8::TickTimers(unsigned int cycles)
+{
+	delayTimer = delayTimer > cycles ? delayTimer - cycles : 0;
+	soundTimer = soundTimer > cycles ? soundTimer - cycles : 0;
+}
+
+unsigned int Chip8::FUSE_6xkk_6xkk_Dxyn(uint16_t const *opcodes)
+{
+	SetRegister((opcodes[0] & 0x0F00u) >> 8u, opcodes[0] & 0x00FFu);
+	SetRegister((opcodes[1] & 0x0F00u) >> 8u, opcodes[1] & 0x00FFu);
+	opcode = opcodes[2];
+	pc += 6;
+	OP_Dxyn();
+	TickTimers(3);
+	return 3;
+}
+
+unsigned int Chip8::FUSE_Fx07_3xkk_1nnn(uint16_t const *opcodes)
+{
+	uint8_t Vx = (opcodes[0] & 0x0F00u) >> 8u;
+	if (((opcodes[1] & 0x0F00u) >> 8u) != Vx)
+	{
+		return 0;
+	}
+
+	// The read happens before the first tick
+	SetRegister(Vx, delayTimer);
+	if (registers[Vx] == (opcodes[1] & 0x00FFu))
+	{
+		// The skip jumps over the JP, so only two instructions run
+		opcode = opcodes[1];
+		pc += 6;
+		TickTimers(2);
+		return 2;
+	}
+
+	opcode = opcodes[2];
+	pc = opcodes[2] & 0x0FFFu;
+	TickTimers(3);
+	return 3;
+}
+
+unsigned int Chip8::FUSE_3xkk_1nnn(uint16_t const *opcodes)
+{
+	if (registers[(opcodes[0] & 0x0F00u) >> 8u] == (opcodes[0] & 0x00FFu))
+	{
+		opcode = opcodes[0];
+		pc += 4;
+		TickTimers(1);
+		return 1;
+	}
+
+	opcode = opcodes[1];
+	pc = opcodes[1] & 0x0FFFu;
+	TickTimers(2);
+	return 2;
+}
+
+unsigned int Chip8::FUSE_4xkk_1nnn(uint16_t const *opcodes)
+{
+	if (registers[(opcodes[0] & 0x0F00u) >> 8u] != (opcodes[0] & 0x00FFu))
+	{
+		opcode = opcodes[0];
+		pc += 4;
+		TickTimers(1);
+		return 1;
+	}
+
+	opcode = opcodes[1];
+	pc = opcodes[1] & 0x0FFFu;
+	TickTimers(2);
+	return 2;
+}
+
+unsigned int Chip8::FUSE_Annn_Fx65(uint16_t const *opcodes)
+{
+	index = opcodes[0] & 0x0FFFu;
+	opcode = opcodes[1];
+	pc += 4;
+	OP_Fx65();
+	TickTimers(2);
+	return 2;
+}
@@ -0,0 +1,197 @@
+#include "fuzz.hpp"
+#include <algorithm>
+#include <cstring>
+
+const size_t MAX_INPUT_EVENTS = 256;
+const uint64_t MAX_RETIME_CYCLES = 1000;
+const uint64_t MAX_PRESS_CYCLES = 600;
+
+char const *FuzzFaultName(FuzzFault fault)
+{
+	switch (fault)
+	{
+	case FuzzFault::None:
+		return "none";
+	case FuzzFault::InvalidOpcode:
+		return "invalid-opcode";
+	case FuzzFault::StackOverflow:
+		return "stack-overflow";
+	case FuzzFault::StackUnderflow:
+		return "stack-underflow";
+	case FuzzFault::MemoryFault:
+		return "memory-fault";
+	case FuzzFault::PcOutOfRange:
+		return "pc-out-of-range";
+	case FuzzFault::Hang:
+		return "hang";
+	}
+	return "unknown";
+}
+
+FuzzExecutor::FuzzExecutor(Chip8 const &initial, uint64_t maxCycles)
+	: maxCycles(maxCycles)
+{
+	initial.Fork(this->initial);
+	std::memset(coverage, 0, sizeof(coverage));
+}
+
+FuzzResult FuzzExecutor::Run(std::vector<InputEvent> const &input)
+{
+	// Snapshot reset: a few KB of copying instead of a new machine per case
+	initial.Fork(machine);
+	std::memset(coverage, 0, sizeof(coverage));
+
+	size_t next = 0;
+	uint64_t lastInput = input.empty() ? 0 : input.back().cycle;
+	uint64_t sampleInterval = 1;
+	uint64_t sinceSample = 0;
+	uint64_t savedHash = 0;
+	bool sampled = false;
+	bool mayLeave = false;
+
+	for (uint64_t cycle = 0; cycle < maxCycles; ++cycle)
+	{
+		while (next < input.size() && input[next].cycle <= cycle)
+		{
+			*machine.GetKeypad() = input[next].keys;
+			++next;
+		}
+
+		uint16_t pc = machine.pc;
+		if (pc + 1u >= MEMORY_SIZE)
+		{
+			return {FuzzFault::PcOutOfRange, pc, cycle};
+		}
+		uint16_t opcode = (machine.memory[pc] << 8u) | machine.memory[pc + 1];
+		coverage[pc / 64] |= 1ull << (pc % 64);
+
+		Operation operation = Decode(opcode);
+		FuzzFault fault = Check(opcode, operation);
+		if (fault != FuzzFault::None)
+		{
+			return {fault, pc, cycle};
+		}
+
+		// The RNG is not part of the state, and a loop that polls the keypad
+		// can be left by pressing a key, so neither counts as a hang
+		mayLeave |= operation == Operation::Rnd || operation == Operation::Skp ||
+					operation == Operation::Sknp || operation == Operation::LdVxK;
+
+		machine.Cycle();
+
+		if (cycle < lastInput)
+		{
+			continue;
+		}
+
+		uint64_t hash = machine.StateHash();
+		if (sampled && !mayLeave && hash == savedHash && machine.SameState(saved))
+		{
+			// Go round the loop once more so that the same loop is reported
+			// at the same address, its lowest, wherever it was entered
+			uint16_t loopStart = machine.pc;
+			for (uint64_t i = 0; i <= sinceSample; ++i)
+			{
+				machine.Cycle();
+				loopStart = machine.pc < loopStart ? machine.pc : loopStart;
+			}
+			return {FuzzFault::Hang, loopStart, cycle + 1};
+		}
+		if (++sinceSample == sampleInterval)
+		{
+			machine.Fork(saved);
+			savedHash = hash;
+			sampled = true;
+			mayLeave = false;
+			sampleInterval <<= 1;
+			sinceSample = 0;
+		}
+	}
+
+	return {FuzzFault::None, machine.pc, maxCycles};
+}
+
+// Faults are detected on the state before the instruction runs
+FuzzFault FuzzExecutor::Check(uint16_t opcode, Operation operation) const
+{
+	unsigned int x = (opcode & 0x0F00u) >> 8u;
+	unsigned int index = machine.index;
+
+	switch (operation)
+	{
+	case Operation::Null:
+		return FuzzFault::InvalidOpcode;
+	case Operation::Call:
+		return machine.sp >= STACK_SIZE ? FuzzFault::StackOverflow : FuzzFault::None;
+	case Operation::Ret:
+		return machine.sp == 0 ? FuzzFault::StackUnderflow : FuzzFault::None;
+	case Operation::Drw:
+		return index + (opcode & 0x000Fu) > MEMORY_SIZE ? FuzzFault::MemoryFault : FuzzFault::None;
+	case Operation::LdB:
+		return index + 3 > MEMORY_SIZE ? FuzzFault::MemoryFault : FuzzFault::None;
+	case Operation::StoreRegs:
+	case Operation::LoadRegs:
+		return index + x + 1 > MEMORY_SIZE ? FuzzFault::MemoryFault : FuzzFault::None;
+	default:
+		return FuzzFault::None;
+	}
+}
+
+void MutateInput(std::vector<InputEvent> &input, std::vector<InputEvent> const &other, uint64_t maxCycles,
+				 std::mt19937_64 &rng)
+{
+	auto randomCycle = [&]() { return rng() % maxCycles; };
+	// Mostly single key presses, which is how ROMs expect to be played
+	auto randomKeys = [&]() { return static_cast<uint16_t>(rng() % 4 == 0 ? 0 : 1u << (rng() % KEYPAD_KEY_COUNT)); };
+
+	unsigned int choice = input.empty() ? 0 : rng() % 6;
+	switch (choice)
+	{
+	case 0: // add an event
+		input.push_back({randomCycle(), randomKeys()});
+		break;
+	case 1: // drop an event
+		input.erase(input.begin() + rng() % input.size());
+		break;
+	case 2: // change which keys an event holds
+		input[rng() % input.size()].keys = randomKeys();
+		break;
+	case 3: // move an event in time
+	{
+		InputEvent &event = input[rng() % input.size()];
+		uint64_t shift = rng() % (2 * MAX_RETIME_CYCLES + 1);
+		event.cycle = event.cycle + shift > MAX_RETIME_CYCLES ? event.cycle + shift - MAX_RETIME_CYCLES : 0;
+		event.cycle = std::min(event.cycle, maxCycles - 1);
+		break;
+	}
+	case 4: // a press followed by a release
+	{
+		uint64_t press = randomCycle();
+		uint64_t release = std::min(press + 1 + rng() % MAX_PRESS_CYCLES, maxCycles - 1);
+		input.push_back({press, static_cast<uint16_t>(1u << (rng() % KEYPAD_KEY_COUNT))});
+		input.push_back({release, 0});
+		break;
+	}
+	default: // keep the head of this sequence and the tail of another
+	{
+		uint64_t cut = randomCycle();
+		input.erase(std::remove_if(input.begin(), input.end(), [cut](InputEvent const &event) { return event.cycle >= cut; }),
+					input.end());
+		for (InputEvent const &event : other)
+		{
+			if (event.cycle >= cut)
+			{
+				input.push_back(event);
+			}
+		}
+		break;
+	}
+	}
+
+	std::stable_sort(input.begin(), input.end(),
+					 [](InputEvent const &a, InputEvent const &b) { return a.cycle < b.cycle; });
+	while (input.size() > MAX_INPUT_EVENTS)
+	{
+		input.erase(input.begin() + rng() % input.size());
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include "lockstep.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+enum class FuzzFault
+{
+	None,
+	InvalidOpcode,	// an opcode the interpreter would run as OP_NULL
+	StackOverflow,	// 2nnn with all 16 stack slots in use
+	StackUnderflow, // 00EE with an empty stack
+	MemoryFault,	// Dxyn, Fx33, Fx55 or Fx65 reaching past the end of memory
+	PcOutOfRange,	// fetch from the last byte of memory or beyond
+	Hang			// the machine returned to an earlier state without reading input
+};
+
+char const *FuzzFaultName(FuzzFault fault);
+
+struct FuzzResult
+{
+	FuzzFault fault;
+	uint16_t pc;	// instruction that faulted, or the lowest address in a hang
+	uint64_t cycle; // cycles run before the fault
+};
+
+const unsigned int COVERAGE_WORDS = MEMORY_SIZE / 64;
+
+// Runs one input sequence on a machine rewound from a snapshot, checking each
+// instruction before it executes for the faults the interpreter would
+// otherwise swallow or turn into undefined behaviour. One executor per thread.
+//
+// A hang is only reported for a loop that no input can leave: once the last
+// input event has passed, states are sampled at power-of-two cycle counts
+// (Brent's method) and a later state with the same StateHash() and identical
+// contents, with no Cxkk or keypad read in between, can only repeat forever.
+class FuzzExecutor
+{
+public:
+	FuzzExecutor(Chip8 const &initial, uint64_t maxCycles);
+
+	FuzzResult Run(std::vector<InputEvent> const &input);
+
+	// Bit n of word n / 64 is set if an instruction at address n ran in the
+	// last Run()
+	uint64_t const *GetCoverage() const { return coverage; }
+
+private:
+	Chip8 initial;
+	Chip8 machine;
+	Chip8 saved; // last state sampled for hang detection
+	uint64_t maxCycles;
+	uint64_t coverage[COVERAGE_WORDS];
+
+	FuzzFault Check(uint16_t opcode, Operation operation) const;
+};
+
+// Apply one random edit to an input sequence: add, drop, retime or change an
+// event, or splice in the tail of another sequence. Events stay sorted by
+// cycle and within maxCycles.
+void MutateInput(std::vector<InputEvent> &input, std::vector<InputEvent> const &other, uint64_t maxCycles,
+				 std::mt19937_64 &rng);
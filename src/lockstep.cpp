@@ -0,0 +1,265 @@
+#include "lockstep.hpp"
+#include "analysis.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+const unsigned int MAX_REPORTED_BYTES = 8;
+
+static std::string Hex(unsigned int value, int width)
+{
+	char text[16];
+	std::snprintf(text, sizeof(text), "0x%0*X", width, value);
+	return text;
+}
+
+bool LoadInputScript(char const *filename, std::vector<InputEvent> &events)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	events.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		std::string cycle;
+		std::string keys;
+		if (!(fields >> cycle))
+		{
+			continue;
+		}
+		if (!(fields >> keys))
+		{
+			return false;
+		}
+
+		try
+		{
+			InputEvent event{std::stoull(cycle, nullptr, 0), static_cast<uint16_t>(std::stoul(keys, nullptr, 0))};
+			if (!events.empty() && event.cycle < events.back().cycle)
+			{
+				return false;
+			}
+			events.push_back(event);
+		}
+		catch (std::exception const &)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SaveInputScript(char const *filename, std::vector<InputEvent> const &events)
+{
+	std::ofstream file(filename);
+	for (InputEvent const &event : events)
+	{
+		file << event.cycle << " " << Hex(event.keys, 4) << "\n";
+	}
+	return static_cast<bool>(file);
+}
+
+LockstepHarness::LockstepHarness(LockstepBackend reference, LockstepBackend candidate, Chip8 const &initial)
+	: reference(std::move(reference)), candidate(std::move(candidate))
+{
+	initial.Fork(referenceMachine);
+	initial.Fork(candidateMachine);
+	Checkpoint();
+}
+
+bool LockstepHarness::Run(uint64_t count)
+{
+	uint64_t end = cycles + count;
+
+	while (cycles < end)
+	{
+		RunChunk(end, false);
+
+		bool same = referenceMachine.StateHash() == candidateMachine.StateHash();
+		if (same && cycles - checkpointCycles >= fullCheckInterval)
+		{
+			// Rule out a hash collision before trusting this as a checkpoint
+			++fullChecks;
+			same = referenceMachine.SameState(candidateMachine);
+			if (same)
+			{
+				Checkpoint();
+			}
+		}
+		if (!same)
+		{
+			Replay(cycles);
+			return false;
+		}
+	}
+
+	++fullChecks;
+	if (!referenceMachine.SameState(candidateMachine))
+	{
+		Replay(cycles);
+		return false;
+	}
+	Checkpoint();
+	return true;
+}
+
+unsigned int LockstepHarness::RunChunk(uint64_t target, bool record)
+{
+	while (nextInput < input.size() && input[nextInput].cycle <= cycles)
+	{
+		*referenceMachine.GetKeypad() = input[nextInput].keys;
+		*candidateMachine.GetKeypad() = input[nextInput].keys;
+		++nextInput;
+	}
+
+	// Chunks never cross a key change, so both sides see it at the same cycle
+	uint64_t limit = target - cycles < budget ? target - cycles : budget;
+	if (nextInput < input.size() && input[nextInput].cycle - cycles < limit)
+	{
+		limit = input[nextInput].cycle - cycles;
+	}
+
+	if (record)
+	{
+		divergence.addresses.clear();
+		divergence.opcodes.clear();
+	}
+
+	unsigned int ran = candidate.step(candidateMachine, static_cast<unsigned int>(limit));
+	for (unsigned int i = 0; i < ran; ++i)
+	{
+		if (record)
+		{
+			uint8_t const *memory = referenceMachine.memory;
+			uint16_t pc = referenceMachine.pc;
+			divergence.addresses.push_back(pc);
+			divergence.opcodes.push_back(pc + 1u < MEMORY_SIZE ? (memory[pc] << 8u) | memory[pc + 1] : 0);
+		}
+		reference.step(referenceMachine, 1);
+	}
+	cycles += ran;
+	return ran;
+}
+
+void LockstepHarness::Checkpoint()
+{
+	referenceMachine.Fork(referenceCheckpoint);
+	candidateMachine.Fork(candidateCheckpoint);
+	checkpointCycles = cycles;
+	checkpointInput = nextInput;
+}
+
+// Rewind to the last state known to match and rerun the same chunks with a
+// full comparison after each one
+void LockstepHarness::Replay(uint64_t target)
+{
+	referenceCheckpoint.Fork(referenceMachine);
+	candidateCheckpoint.Fork(candidateMachine);
+	cycles = checkpointCycles;
+	nextInput = checkpointInput;
+
+	while (cycles < target)
+	{
+		divergence.cycle = cycles;
+		RunChunk(target, true);
+		if (!referenceMachine.SameState(candidateMachine))
+		{
+			break;
+		}
+	}
+
+	Describe();
+}
+
+void LockstepHarness::Describe()
+{
+	Chip8 const &a = referenceMachine;
+	Chip8 const &b = candidateMachine;
+	std::vector<std::string> &out = divergence.differences;
+	out.clear();
+
+	auto field = [&out](std::string const &name, unsigned int left, unsigned int right, int width)
+	{
+		if (left != right)
+		{
+			out.push_back(name + ": " + Hex(left, width) + " vs " + Hex(right, width));
+		}
+	};
+
+	for (unsigned int i = 0; i < REGISTER_COUNT; ++i)
+	{
+		char name[4];
+		std::snprintf(name, sizeof(name), "V%X", i);
+		field(name, a.registers[i], b.registers[i], 2);
+	}
+	field("I", a.index, b.index, 3);
+	field("pc", a.pc, b.pc, 3);
+	field("sp", a.sp, b.sp, 2);
+	field("DT", a.delayTimer, b.delayTimer, 2);
+	field("ST", a.soundTimer, b.soundTimer, 2);
+	for (unsigned int i = 0; i < STACK_SIZE; ++i)
+	{
+		field("stack[" + std::to_string(i) + "]", a.stack[i], b.stack[i], 3);
+	}
+
+	unsigned int bytes = 0;
+	for (unsigned int address = 0; address < MEMORY_SIZE; ++address)
+	{
+		if (a.memory[address] != b.memory[address] && bytes++ < MAX_REPORTED_BYTES)
+		{
+			field("memory[" + Hex(address, 3) + "]", a.memory[address], b.memory[address], 2);
+		}
+	}
+	if (bytes > MAX_REPORTED_BYTES)
+	{
+		out.push_back("... " + std::to_string(bytes - MAX_REPORTED_BYTES) + " more bytes of memory");
+	}
+
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		if (a.video[row] != b.video[row])
+		{
+			char text[64];
+			std::snprintf(text, sizeof(text), "video row %u: %016llX vs %016llX", row,
+						  static_cast<unsigned long long>(a.video[row]), static_cast<unsigned long long>(b.video[row]));
+			out.push_back(text);
+		}
+	}
+
+	// A candidate that behaves differently the second time round leaves
+	// nothing to point at
+	if (out.empty())
+	{
+		divergence.cycle = checkpointCycles;
+		divergence.addresses.clear();
+		divergence.opcodes.clear();
+		out.push_back("mismatch did not reproduce when replayed from cycle " + std::to_string(checkpointCycles) +
+					  "; the candidate may not be deterministic");
+	}
+}
+
+void LockstepHarness::PrintDivergence(std::ostream &out) const
+{
+	out << reference.name << " and " << candidate.name << " diverge";
+	if (!divergence.opcodes.empty())
+	{
+		out << " in the " << divergence.opcodes.size() << "-cycle chunk";
+	}
+	out << " starting at cycle " << divergence.cycle << "\n";
+	for (size_t i = 0; i < divergence.opcodes.size(); ++i)
+	{
+		out << "  " << Hex(divergence.addresses[i], 3) << "  " << Hex(divergence.opcodes[i], 4) << "  "
+			<< Disassemble(divergence.opcodes[i]) << "\n";
+	}
+	out << "state after the chunk (" << reference.name << " vs " << candidate.name << "):\n";
+	for (std::string const &line : divergence.differences)
+	{
+		out << "  " << line << "\n";
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Keypad mask to apply from a given cycle on
+struct InputEvent
+{
+	uint64_t cycle;
+	uint16_t keys;
+};
+
+// Input scripts hold one "cycle keymask" pair per line, cycles in ascending
+// order; '#' starts a comment. Returns false if the file cannot be read or a
+// line does not parse.
+bool LoadInputScript(char const *filename, std::vector<InputEvent> &events);
+bool SaveInputScript(char const *filename, std::vector<InputEvent> const &events);
+
+// A way of advancing a machine: run at most budget cycles and return how many
+// were run (at least one). Chip8::Cycle, Chip8::Step and AotBackend::Step all
+// fit this shape.
+struct LockstepBackend
+{
+	std::string name;
+	std::function<unsigned int(Chip8 &, unsigned int budget)> step;
+};
+
+struct Divergence
+{
+	uint64_t cycle; // cycles run by both machines before the chunk
+	std::vector<uint16_t> addresses; // what the reference ran in the chunk
+	std::vector<uint16_t> opcodes;
+	std::vector<std::string> differences; // one line per field that differs
+};
+
+// Runs a reference and a candidate backend side by side from the same state
+// and input. The candidate advances in chunks of up to budget cycles and the
+// reference follows it one instruction at a time, so both are compared at
+// every point the candidate stops.
+//
+// Each compare checks Chip8::StateHash() on both sides, which covers the
+// whole state and costs nothing extra. A full SameState() comparison runs
+// every fullCheckInterval cycles to rule out a hash collision before the
+// state is kept as a checkpoint. On a mismatch both machines are rewound to
+// the last checkpoint and replayed with a full comparison after every chunk
+// to find the first bad one.
+class LockstepHarness
+{
+public:
+	LockstepHarness(LockstepBackend reference, LockstepBackend candidate, Chip8 const &initial);
+
+	void SetInput(std::vector<InputEvent> events) { input = std::move(events); }
+	void SetBudget(unsigned int cycles) { budget = cycles > 0 ? cycles : 1; }
+	void SetFullCheckInterval(uint64_t cycles) { fullCheckInterval = cycles; }
+
+	// Returns false at the first divergence
+	bool Run(uint64_t cycles);
+
+	uint64_t GetCycles() const { return cycles; }
+	uint64_t GetStateHash() const { return referenceMachine.StateHash(); }
+	uint64_t GetFullChecks() const { return fullChecks; }
+	Divergence const &GetDivergence() const { return divergence; }
+	void PrintDivergence(std::ostream &out) const;
+
+private:
+	LockstepBackend reference;
+	LockstepBackend candidate;
+	Chip8 referenceMachine;
+	Chip8 candidateMachine;
+	Chip8 referenceCheckpoint;
+	Chip8 candidateCheckpoint;
+
+	std::vector<InputEvent> input;
+	size_t nextInput{};
+	unsigned int budget{64};
+	uint64_t fullCheckInterval{100000};
+
+	uint64_t cycles{};
+	uint64_t checkpointCycles{};
+	size_t checkpointInput{};
+	uint64_t fullChecks{};
+	Divergence divergence{};
+
+	unsigned int RunChunk(uint64_t target, bool record);
+	void Checkpoint();
+	void Replay(uint64_t target);
+	void Describe();
+};
@@ -1,43 +1,235 @@
 #include "chip8.hpp"
 #include "platform.hpp"
+#ifdef MAYOCHIP8_STREAM
+#include "stream.hpp"
+#endif
+#include "vip.hpp"
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <cstdlib>
+#include <memory>
+
+// Speed multipliers cycled by the turbo hotkey; 0 means uncapped
+const unsigned int SPEEDS[] = {1, 2, 8, 0};
+const unsigned int SPEED_COUNT = sizeof(SPEEDS) / sizeof(SPEEDS[0]);
+const float PRESENT_INTERVAL_MS = 1000.0f / 60.0f;
+const float MAX_CATCH_UP_MS = 100.0f;
+const unsigned int UNCAPPED_BATCH_CYCLES = 1024;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float MillisecondsSince(Clock::time_point start, Clock::time_point now)
+{
+    return std::chrono::duration<float, std::chrono::milliseconds::period>(now - start).count();
+}
+
+static void Usage(char const *program)
+{
+    std::cerr << "Usage: " << program << " [--stream <Socket>] [--speed 1|2|8|max] [--timing vip] <Scale> <Delay> <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
 
 int main(int argc, char **argv)
 {
-    if (argc != 4)
+    char const *streamPath = nullptr;
+    unsigned int speedIndex = 0;
+    bool vipTiming = false;
+
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2)
     {
-        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
-        std::exit(EXIT_FAILURE);
+        if (std::strcmp(argv[arg], "--stream") == 0)
+        {
+            streamPath = argv[arg + 1];
+        }
+        else if (std::strcmp(argv[arg], "--speed") == 0)
+        {
+            // "max" is the uncapped speed, anything else must be one of the
+            // listed multipliers; 0 is not accepted as a spelling of "max"
+            char *end = nullptr;
+            unsigned long speed = std::strcmp(argv[arg + 1], "max") == 0 ? 0 : std::strtoul(argv[arg + 1], &end, 10);
+            if (end && (end == argv[arg + 1] || *end != '\0' || speed == 0))
+            {
+                Usage(argv[0]);
+            }
+            for (speedIndex = 0; speedIndex < SPEED_COUNT && SPEEDS[speedIndex] != speed; ++speedIndex)
+            {
+            }
+            if (speedIndex == SPEED_COUNT)
+            {
+                Usage(argv[0]);
+            }
+        }
+        else if (std::strcmp(argv[arg], "--timing") == 0 && std::strcmp(argv[arg + 1], "vip") == 0)
+        {
+            vipTiming = true;
+        }
+        else
+        {
+            Usage(argv[0]);
+        }
+    }
+
+    if (argc - arg != 3)
+    {
+        Usage(argv[0]);
+    }
+
+    // The delay is the time per instruction at 1x and may be fractional,
+    // e.g. 0.25 for 4000 instructions per second. With VIP timing the pace is
+    // set by the VIP's clock instead, and cycles below are machine cycles.
+    // A delay of 0 runs uncapped, as it always has, and Tab then does nothing.
+    int videoScale = std::stoi(argv[arg]);
+    float cycleDelay = std::stof(argv[arg + 1]);
+    char const *romFileName = argv[arg + 2];
+    if (cycleDelay < 0.0f)
+    {
+        Usage(argv[0]);
+    }
+    if (vipTiming)
+    {
+        cycleDelay = static_cast<float>(1000.0 / VIP_MACHINE_CYCLES_PER_SECOND);
+    }
+    bool fixedUncapped = cycleDelay == 0.0f;
+    if (fixedUncapped)
+    {
+        speedIndex = SPEED_COUNT - 1;
     }
 
-    int videoScale = std::stoi(argv[1]);
-    int cycleDelay = std::stoi(argv[2]);
-    char const *romFileName = argv[3];
+#ifdef MAYOCHIP8_STREAM
+    std::unique_ptr<FrameStreamer> streamer;
+    if (streamPath)
+    {
+        streamer.reset(new FrameStreamer(streamPath));
+        if (!streamer->IsOpen())
+        {
+            std::cerr << "Could not listen on " << streamPath << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+#else
+    if (streamPath)
+    {
+        std::cerr << "--stream needs Unix domain sockets, which this build does not have\n";
+        std::exit(EXIT_FAILURE);
+    }
+#endif
 
     Platform platform("mayoCHIP8 Emulator", VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
     Chip8 chip8;
     chip8.LoadRom(romFileName);
 
-    int videoPitch = sizeof(chip8.GetVideo()[0]) * VIDEO_WIDTH;
+    std::unique_ptr<VipTiming> vip;
+    if (vipTiming)
+    {
+        vip.reset(new VipTiming(chip8));
+    }
+    auto run = [&](uint64_t cycles) {
+        if (vip)
+        {
+            vip->Run(cycles);
+        }
+        else
+        {
+            chip8.Run(cycles);
+        }
+    };
+    uint64_t batchCycles = vip ? VIP_CYCLES_PER_FRAME : UNCAPPED_BATCH_CYCLES;
+
+    uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+    int videoPitch = sizeof(pixels[0]) * VIDEO_WIDTH;
 
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
+    auto lastCycleTime = Clock::now();
+    auto lastPresentTime = lastCycleTime;
+    auto lastReadoutTime = lastCycleTime;
+    float owedCycles = 0.0f;
+    uint64_t readoutCycles = 0;
+    bool dirty = false;
     bool quit = false;
 
     while (!quit)
     {
         quit = platform.ProcessInput(chip8.GetKeypad());
+        if (platform.TakeTurboPress() && !fixedUncapped)
+        {
+            speedIndex = (speedIndex + 1) % SPEED_COUNT;
+            owedCycles = 0.0f;
+        }
+
+        // Run whatever the wall clock says is due at the current speed. After
+        // a stall only a bounded backlog is made up, instead of racing ahead.
+        auto currentTime = Clock::now();
+        float dt = MillisecondsSince(lastCycleTime, currentTime);
+        lastCycleTime = currentTime;
+        unsigned int speed = SPEEDS[speedIndex];
+        uint64_t cycles = 0;
+
+        if (speed > 0)
+        {
+            float maxOwed = MAX_CATCH_UP_MS / cycleDelay * speed;
+            owedCycles += dt / cycleDelay * speed;
+            owedCycles = owedCycles < maxOwed ? owedCycles : maxOwed;
+            cycles = static_cast<uint64_t>(owedCycles);
+            owedCycles -= cycles;
+            run(cycles);
+        }
+        else
+        {
+            // Uncapped: emulate for the rest of the host frame
+            do
+            {
+                run(batchCycles);
+                cycles += batchCycles;
+            } while (MillisecondsSince(lastPresentTime, Clock::now()) < PRESENT_INTERVAL_MS);
+        }
+        readoutCycles += cycles;
+        dirty |= cycles > 0;
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+        // However many frames the machine ran, only the latest is shown
+        currentTime = Clock::now();
+        if (dirty && MillisecondsSince(lastPresentTime, currentTime) >= PRESENT_INTERVAL_MS)
+        {
+            lastPresentTime = currentTime;
+            dirty = false;
+            chip8.RenderVideo(pixels);
+            platform.Update(pixels, videoPitch);
+#ifdef MAYOCHIP8_STREAM
+            if (streamer)
+            {
+                streamer->Publish(chip8.GetVideo());
+            }
+#endif
+        }
 
-        if (dt > cycleDelay)
+        float sinceReadout = MillisecondsSince(lastReadoutTime, currentTime);
+        if (sinceReadout >= 1000.0f)
         {
-            lastCycleTime = currentTime;
-            chip8.Cycle();
-            platform.Update(chip8.GetVideo(), videoPitch);
+            // Achieved speed relative to 1x, whatever the setting asked for
+            char title[64];
+            float achieved = readoutCycles * cycleDelay / sinceReadout;
+            if (fixedUncapped)
+            {
+                std::snprintf(title, sizeof(title), "mayoCHIP8 Emulator - %.0f instructions/s",
+                              readoutCycles * 1000.0f / sinceReadout);
+            }
+            else if (speed == 1)
+            {
+                std::snprintf(title, sizeof(title), "mayoCHIP8 Emulator - %.1fx", achieved);
+            }
+            else if (speed > 0)
+            {
+                std::snprintf(title, sizeof(title), "mayoCHIP8 Emulator - %.1fx (turbo %ux)", achieved, speed);
+            }
+            else
+            {
+                std::snprintf(title, sizeof(title), "mayoCHIP8 Emulator - %.1fx (turbo max)", achieved);
+            }
+            platform.SetTitle(title);
+            lastReadoutTime = currentTime;
+            readoutCycles = 0;
         }
     }
     return 0;
-}
\ No newline at end of file
+}
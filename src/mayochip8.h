@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+ * C interface to the mayoCHIP8 core, built as libmayochip8.
+ *
+ * Every pointer returned by mc8_framebuffer() and mc8_state() points straight
+ * into the machine and stays valid until the machine is destroyed, so hosts
+ * can read observations after each step without copying. The pointed-to data
+ * must be treated as read-only.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* MC8_BUILDING is defined only while building libmayochip8 itself */
+#if defined(_WIN32) && defined(MC8_BUILDING)
+#define MC8_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define MC8_API __declspec(dllimport)
+#else
+#define MC8_API __attribute__((visibility("default")))
+#endif
+
+#define MC8_API_VERSION 4
+
+#define MC8_VIDEO_WIDTH 64
+#define MC8_VIDEO_HEIGHT 32
+#define MC8_MAX_ROM_SIZE (4096 - 0x200)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef struct mc8_machine mc8_machine;
+
+	/* Read-only views into the machine's register file and memory */
+	typedef struct mc8_state_view
+	{
+		const uint8_t *registers; /* V0..VF */
+		const uint8_t *memory;	  /* 4096 bytes */
+		const uint16_t *stack;	  /* 16 entries */
+		const uint16_t *index;
+		const uint16_t *pc;
+		const uint8_t *sp;
+		const uint8_t *delay_timer;
+		const uint8_t *sound_timer;
+	} mc8_state_view;
+
+	MC8_API unsigned int mc8_api_version(void);
+
+	MC8_API mc8_machine *mc8_create(void);
+	MC8_API void mc8_destroy(mc8_machine *machine);
+
+	/* Returns 0 on success, -1 if the ROM does not fit in memory. Loading also
+	 * resets the machine. */
+	MC8_API int mc8_load_rom(mc8_machine *machine, const uint8_t *data, size_t size);
+	MC8_API void mc8_reset(mc8_machine *machine);
+	MC8_API void mc8_seed(mc8_machine *machine, uint32_t seed);
+
+	/* A frame is cycles_per_frame calls to Cycle(), 1 by default. The SDL
+	 * frontend paces cycles by its delay and presents at most 60 times a
+	 * second, so a host that wants the same should set this to the number of
+	 * cycles it runs between presents. */
+	MC8_API void mc8_set_cycles_per_frame(mc8_machine *machine, unsigned int cycles);
+	MC8_API void mc8_step_frames(mc8_machine *machine, unsigned int frames);
+
+	/* Bit n set means key n is held */
+	MC8_API void mc8_set_keys(mc8_machine *machine, uint16_t keys);
+
+	/* Returns a new machine in the same state, or NULL on allocation failure */
+	MC8_API mc8_machine *mc8_fork(const mc8_machine *machine);
+
+	/* Publish every frame stepped by mc8_step_frames() to viewers connected
+	 * to a Unix domain socket at socket_path (see tools/chip8watch). Sending
+	 * never blocks; slow viewers miss frames. Passing NULL stops streaming.
+	 * Returns 0 on success, -1 if the socket cannot be created or the library
+	 * was built for a platform without Unix domain sockets. Forks do not
+	 * inherit the stream. */
+	MC8_API int mc8_stream_open(mc8_machine *machine, const char *socket_path);
+
+	/* 32 rows of 64 pixels, one word per row with the leftmost pixel in the
+	 * most significant bit */
+	MC8_API const uint64_t *mc8_framebuffer(const mc8_machine *machine);
+	MC8_API const mc8_state_view *mc8_state(const mc8_machine *machine);
+
+	/* 64-bit hash of the registers, memory, stack, framebuffer, I, pc, sp and
+	 * timers, maintained as the machine runs so reading it is O(1). Equal
+	 * states hash equal; use it to skip states a search has already seen. */
+	MC8_API uint64_t mc8_state_hash(const mc8_machine *machine);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,7 +25,19 @@ void Platform::Update(void const *buffer, int pitch)
     SDL_RenderPresent(renderer);
 }
 
-bool Platform::ProcessInput(uint8_t *keys)
+void Platform::SetTitle(char const *title)
+{
+    SDL_SetWindowTitle(window, title);
+}
+
+bool Platform::TakeTurboPress()
+{
+    bool pressed = turboPressed;
+    turboPressed = false;
+    return pressed;
+}
+
+bool Platform::ProcessInput(uint16_t *keys)
 {
     bool quit = false;
     SDL_Event event;
@@ -50,99 +62,108 @@ bool Platform::ProcessInput(uint8_t *keys)
             }
             break;
 
+            case SDLK_TAB:
+            {
+                if (!event.key.repeat)
+                {
+                    turboPressed = true;
+                }
+            }
+            break;
+
             case SDLK_x:
             {
-                keys[0] = 1;
+                *keys |= 1u << 0;
             }
             break;
 
             case SDLK_1:
             {
-                keys[1] = 1;
+                *keys |= 1u << 1;
             }
             break;
 
             case SDLK_2:
             {
-                keys[2] = 1;
+                *keys |= 1u << 2;
             }
             break;
 
             case SDLK_3:
             {
-                keys[3] = 1;
+                *keys |= 1u << 3;
             }
             break;
 
             case SDLK_q:
             {
-                keys[4] = 1;
+                *keys |= 1u << 4;
             }
             break;
 
             case SDLK_w:
             {
-                keys[5] = 1;
+                *keys |= 1u << 5;
             }
             break;
 
             case SDLK_e:
             {
-                keys[6] = 1;
+                *keys |= 1u << 6;
             }
             break;
 
             case SDLK_a:
             {
-                keys[7] = 1;
+                *keys |= 1u << 7;
             }
             break;
 
             case SDLK_s:
             {
-                keys[8] = 1;
+                *keys |= 1u << 8;
             }
             break;
 
             case SDLK_d:
             {
-                keys[9] = 1;
+                *keys |= 1u << 9;
             }
             break;
 
             case SDLK_z:
             {
-                keys[0xA] = 1;
+                *keys |= 1u << 0xA;
             }
             break;
 
             case SDLK_c:
             {
-                keys[0xB] = 1;
+                *keys |= 1u << 0xB;
             }
             break;
 
             case SDLK_4:
             {
-                keys[0xC] = 1;
+                *keys |= 1u << 0xC;
             }
             break;
 
             case SDLK_r:
             {
-                keys[0xD] = 1;
+                *keys |= 1u << 0xD;
             }
             break;
 
             case SDLK_f:
             {
-                keys[0xE] = 1;
+                *keys |= 1u << 0xE;
             }
             break;
 
             case SDLK_v:
             {
-                keys[0xF] = 1;
+                *keys |= 1u << 0xF;
             }
             break;
             }
@@ -155,97 +176,97 @@ bool Platform::ProcessInput(uint8_t *keys)
             {
             case SDLK_x:
             {
-                keys[0] = 0;
+                *keys &= ~(1u << 0);
             }
             break;
 
             case SDLK_1:
             {
-                keys[1] = 0;
+                *keys &= ~(1u << 1);
             }
             break;
 
             case SDLK_2:
             {
-                keys[2] = 0;
+                *keys &= ~(1u << 2);
             }
             break;
 
             case SDLK_3:
             {
-                keys[3] = 0;
+                *keys &= ~(1u << 3);
             }
             break;
 
             case SDLK_q:
             {
-                keys[4] = 0;
+                *keys &= ~(1u << 4);
             }
             break;
 
             case SDLK_w:
             {
-                keys[5] = 0;
+                *keys &= ~(1u << 5);
             }
             break;
 
             case SDLK_e:
             {
-                keys[6] = 0;
+                *keys &= ~(1u << 6);
             }
             break;
 
             case SDLK_a:
             {
-                keys[7] = 0;
+                *keys &= ~(1u << 7);
             }
             break;
 
             case SDLK_s:
             {
-                keys[8] = 0;
+                *keys &= ~(1u << 8);
             }
             break;
 
             case SDLK_d:
             {
-                keys[9] = 0;
+                *keys &= ~(1u << 9);
             }
             break;
 
             case SDLK_z:
             {
-                keys[0xA] = 0;
+                *keys &= ~(1u << 0xA);
             }
             break;
 
             case SDLK_c:
             {
-                keys[0xB] = 0;
+                *keys &= ~(1u << 0xB);
             }
             break;
 
             case SDLK_4:
             {
-                keys[0xC] = 0;
+                *keys &= ~(1u << 0xC);
             }
             break;
 
             case SDLK_r:
             {
-                keys[0xD] = 0;
+                *keys &= ~(1u << 0xD);
             }
             break;
 
             case SDLK_f:
             {
-                keys[0xE] = 0;
+                *keys &= ~(1u << 0xE);
             }
             break;
 
             case SDLK_v:
             {
-                keys[0xF] = 0;
+                *keys &= ~(1u << 0xF);
             }
             break;
             }
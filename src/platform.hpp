@@ -13,10 +13,15 @@ public:
     Platform(char const *title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
     ~Platform();
     void Update(void const *buffer, int pitch);
-    bool ProcessInput(uint8_t *keys);
+    bool ProcessInput(uint16_t *keys);
+    void SetTitle(char const *title);
+
+    // True once for each press of the turbo key (Tab) since the last call
+    bool TakeTurboPress();
 
 private:
     SDL_Window *window{};
     SDL_Renderer *renderer{};
     SDL_Texture *texture{};
+    bool turboPressed{};
 };
@@ -0,0 +1,299 @@
+#include "stream.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Linux reports a closed viewer through EPIPE only when told not to raise
+// SIGPIPE; macOS has no MSG_NOSIGNAL and uses SO_NOSIGPIPE per socket instead
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+const unsigned int MAX_LISTEN_BACKLOG = 16;
+
+void EncodeFrameRows(uint64_t const *rows, uint8_t *bytes)
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		for (unsigned int byte = 0; byte < 8; ++byte)
+		{
+			bytes[row * 8 + byte] = static_cast<uint8_t>(rows[row] >> (56 - byte * 8));
+		}
+	}
+}
+
+void DecodeFrameRows(uint8_t const *bytes, uint64_t *rows)
+{
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		uint64_t value = 0;
+		for (unsigned int byte = 0; byte < 8; ++byte)
+		{
+			value = (value << 8) | bytes[row * 8 + byte];
+		}
+		rows[row] = value;
+	}
+}
+
+void EncodeStreamPacket(uint8_t type, uint32_t frame, uint8_t const *image, std::vector<uint8_t> &packet)
+{
+	packet.assign(STREAM_HEADER_SIZE, 0);
+	packet[0] = 'C';
+	packet[1] = '8';
+	packet[2] = type;
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		packet[4 + i] = static_cast<uint8_t>(frame >> (i * 8));
+	}
+
+	// Changes between frames are a few sprite rows, so the image is mostly
+	// zero: store zero runs as a count and everything else literally. A lone
+	// zero inside a literal run is cheaper to keep than to split on.
+	size_t pos = 0;
+	while (pos < STREAM_FRAME_BYTES)
+	{
+		size_t zeros = 0;
+		while (pos + zeros < STREAM_FRAME_BYTES && zeros < 255 && image[pos + zeros] == 0)
+		{
+			++zeros;
+		}
+		pos += zeros;
+		if (pos == STREAM_FRAME_BYTES)
+		{
+			break;
+		}
+
+		size_t literals = 0;
+		while (pos + literals < STREAM_FRAME_BYTES && literals < 255)
+		{
+			size_t next = pos + literals;
+			if (image[next] == 0 && (next + 1 == STREAM_FRAME_BYTES || image[next + 1] == 0))
+			{
+				break;
+			}
+			++literals;
+		}
+
+		packet.push_back(static_cast<uint8_t>(zeros));
+		packet.push_back(static_cast<uint8_t>(literals));
+		packet.insert(packet.end(), image + pos, image + pos + literals);
+		pos += literals;
+	}
+
+	size_t length = packet.size() - STREAM_HEADER_SIZE;
+	packet[8] = static_cast<uint8_t>(length);
+	packet[9] = static_cast<uint8_t>(length >> 8);
+}
+
+bool ApplyStreamPayload(uint8_t const *payload, size_t length, uint8_t *image)
+{
+	size_t pos = 0;
+	size_t in = 0;
+	while (in < length)
+	{
+		if (in + 2 > length)
+		{
+			return false;
+		}
+		size_t zeros = payload[in];
+		size_t literals = payload[in + 1];
+		in += 2;
+		pos += zeros;
+		if (pos + literals > STREAM_FRAME_BYTES || in + literals > length)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < literals; ++i)
+		{
+			image[pos + i] ^= payload[in + i];
+		}
+		pos += literals;
+		in += literals;
+	}
+	return true;
+}
+
+FrameStreamer::FrameStreamer(char const *socketPath)
+	: path(socketPath)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		return;
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	// Replace a socket left behind by an earlier run, but nothing else
+	struct stat info;
+	if (lstat(socketPath, &info) == 0 && S_ISSOCK(info.st_mode))
+	{
+		unlink(socketPath);
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return;
+	}
+	if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+		listen(fd, MAX_LISTEN_BACKLOG) != 0 ||
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+	{
+		close(fd);
+		return;
+	}
+	listenFd = fd;
+}
+
+FrameStreamer::~FrameStreamer()
+{
+	for (Subscriber const &subscriber : subscribers)
+	{
+		close(subscriber.fd);
+	}
+	if (listenFd >= 0)
+	{
+		close(listenFd);
+		unlink(path.c_str());
+	}
+}
+
+void FrameStreamer::AcceptSubscribers()
+{
+	int fd;
+	while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+	{
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+		subscribers.push_back({fd, true, nullptr, 0});
+	}
+}
+
+// Returns false once the subscriber has gone away
+bool FrameStreamer::Send(Subscriber &subscriber, Packet const &packet)
+{
+	ssize_t sent = send(subscriber.fd, packet->data(), packet->size(), SEND_FLAGS);
+	if (sent < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			return false;
+		}
+		// Nothing went out, so the viewer's image is still consistent and
+		// only needs a keyframe to catch up
+		subscriber.needsKeyframe = true;
+		++droppedFrames;
+		return true;
+	}
+
+	// Once part of a packet is on the wire the rest has to follow it
+	if (static_cast<size_t>(sent) < packet->size())
+	{
+		subscriber.pending = packet;
+		subscriber.pendingOffset = static_cast<size_t>(sent);
+	}
+	subscriber.needsKeyframe = false;
+	return true;
+}
+
+bool FrameStreamer::FlushPending(Subscriber &subscriber)
+{
+	if (!subscriber.pending)
+	{
+		return true;
+	}
+
+	size_t remaining = subscriber.pending->size() - subscriber.pendingOffset;
+	ssize_t sent = send(subscriber.fd, subscriber.pending->data() + subscriber.pendingOffset, remaining, SEND_FLAGS);
+	if (sent < 0)
+	{
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+	subscriber.pendingOffset += static_cast<size_t>(sent);
+	if (subscriber.pendingOffset == subscriber.pending->size())
+	{
+		subscriber.pending.reset();
+	}
+	return true;
+}
+
+void FrameStreamer::Publish(uint64_t const *video)
+{
+	if (listenFd < 0)
+	{
+		return;
+	}
+	AcceptSubscribers();
+
+	uint8_t image[STREAM_FRAME_BYTES];
+	uint8_t delta[STREAM_FRAME_BYTES];
+	bool changed = false;
+	EncodeFrameRows(video, image);
+	for (size_t i = 0; i < STREAM_FRAME_BYTES; ++i)
+	{
+		delta[i] = image[i] ^ previous[i];
+		changed |= delta[i] != 0;
+	}
+	std::memcpy(previous, image, sizeof(previous));
+	++frame;
+
+	// Each kind of packet is encoded at most once per frame and shared by
+	// every subscriber that takes it
+	Packet deltaPacket;
+	Packet keyPacket;
+
+	for (size_t i = 0; i < subscribers.size();)
+	{
+		Subscriber &subscriber = subscribers[i];
+		bool alive = FlushPending(subscriber);
+
+		if (alive && subscriber.pending)
+		{
+			if (changed)
+			{
+				subscriber.needsKeyframe = true;
+				++droppedFrames;
+			}
+		}
+		else if (alive && subscriber.needsKeyframe)
+		{
+			if (!keyPacket)
+			{
+				auto packet = std::make_shared<std::vector<uint8_t>>();
+				EncodeStreamPacket(STREAM_KEYFRAME, frame, image, *packet);
+				keyPacket = packet;
+			}
+			alive = Send(subscriber, keyPacket);
+		}
+		else if (alive && changed)
+		{
+			if (!deltaPacket)
+			{
+				auto packet = std::make_shared<std::vector<uint8_t>>();
+				EncodeStreamPacket(STREAM_DELTA, frame, delta, *packet);
+				deltaPacket = packet;
+			}
+			alive = Send(subscriber, deltaPacket);
+		}
+
+		if (alive)
+		{
+			++i;
+		}
+		else
+		{
+			close(subscriber.fd);
+			subscribers.erase(subscribers.begin() + static_cast<std::ptrdiff_t>(i));
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Wire format, one packet per published frame:
+//   'C' '8' type(1) reserved(1) frame(4, LE) length(2, LE) payload(length)
+// type is STREAM_KEYFRAME (payload encodes the frame itself) or STREAM_DELTA
+// (payload encodes the XOR with the previous frame). The 256-byte image is
+// the video rows in order, each row big-endian so byte 0 holds x = 0..7. The
+// payload is a list of (zero run, literal count, literals...) groups.
+const uint8_t STREAM_KEYFRAME = 1;
+const uint8_t STREAM_DELTA = 2;
+const size_t STREAM_HEADER_SIZE = 10;
+const size_t STREAM_FRAME_BYTES = VIDEO_HEIGHT * sizeof(uint64_t);
+
+void EncodeFrameRows(uint64_t const *rows, uint8_t *bytes);
+void DecodeFrameRows(uint8_t const *bytes, uint64_t *rows);
+void EncodeStreamPacket(uint8_t type, uint32_t frame, uint8_t const *image, std::vector<uint8_t> &packet);
+// XOR a payload into image; returns false if the payload is malformed
+bool ApplyStreamPayload(uint8_t const *payload, size_t length, uint8_t *image);
+
+// Publishes the display to any number of local subscribers over a Unix
+// domain socket. Each frame is encoded once and the same buffer is handed to
+// every subscriber. All sockets are non-blocking: a subscriber that cannot
+// take a frame right away misses it and gets a keyframe once it catches up,
+// so a slow viewer never stalls the emulator.
+class FrameStreamer
+{
+public:
+	explicit FrameStreamer(char const *socketPath);
+	~FrameStreamer();
+	FrameStreamer(FrameStreamer const &) = delete;
+	FrameStreamer &operator=(FrameStreamer const &) = delete;
+
+	bool IsOpen() const { return listenFd >= 0; }
+	void Publish(uint64_t const *video);
+
+	size_t GetSubscriberCount() const { return subscribers.size(); }
+	uint64_t GetDroppedFrames() const { return droppedFrames; }
+
+private:
+	typedef std::shared_ptr<std::vector<uint8_t> const> Packet;
+
+	struct Subscriber
+	{
+		int fd;
+		bool needsKeyframe;
+		Packet pending; // partly written packet, finished before anything else
+		size_t pendingOffset;
+	};
+
+	int listenFd{-1};
+	std::string path;
+	std::vector<Subscriber> subscribers;
+	uint8_t previous[STREAM_FRAME_BYTES]{};
+	uint32_t frame{};
+	uint64_t droppedFrames{};
+
+	void AcceptSubscribers();
+	bool Send(Subscriber &subscriber, Packet const &packet);
+	bool FlushPending(Subscriber &subscriber);
+};
@@ -0,0 +1,77 @@
+#include "transposition.hpp"
+
+// 0 is the empty marker, so a state that really hashes to 0 is stored as this
+const uint64_t ZERO_HASH_STAND_IN = 0x9E3779B97F4A7C15ull;
+
+TranspositionTable::TranspositionTable(size_t capacity)
+{
+	size_t rounded = 1;
+	while (rounded < capacity)
+	{
+		rounded <<= 1;
+	}
+	mask = rounded - 1;
+	slots.reset(new std::atomic<uint64_t>[rounded]);
+	Clear();
+}
+
+bool TranspositionTable::Insert(uint64_t hash)
+{
+	hash = hash ? hash : ZERO_HASH_STAND_IN;
+
+	// Linear probing from the low bits; the hash is already well mixed
+	for (unsigned int probe = 0; probe < MAX_PROBES; ++probe)
+	{
+		std::atomic<uint64_t> &slot = slots[(hash + probe) & mask];
+		uint64_t current = slot.load(std::memory_order_acquire);
+		if (current == hash)
+		{
+			return false;
+		}
+		if (current == 0)
+		{
+			if (slot.compare_exchange_strong(current, hash, std::memory_order_acq_rel))
+			{
+				size.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+			// Another thread claimed the slot first, maybe with the same state
+			if (current == hash)
+			{
+				return false;
+			}
+		}
+	}
+
+	overflows.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool TranspositionTable::Contains(uint64_t hash) const
+{
+	hash = hash ? hash : ZERO_HASH_STAND_IN;
+
+	for (unsigned int probe = 0; probe < MAX_PROBES; ++probe)
+	{
+		uint64_t current = slots[(hash + probe) & mask].load(std::memory_order_acquire);
+		if (current == hash)
+		{
+			return true;
+		}
+		if (current == 0)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::Clear()
+{
+	for (size_t i = 0; i <= mask; ++i)
+	{
+		slots[i].store(0, std::memory_order_relaxed);
+	}
+	size.store(0, std::memory_order_relaxed);
+	overflows.store(0, std::memory_order_relaxed);
+}
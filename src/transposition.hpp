@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size set of Chip8::StateHash() values that any number of threads can
+// insert into at once without locks. Slots are claimed with a single
+// compare-and-swap and never freed, so a batch runner can ask "has any
+// thread reached this state before?" and prune if so.
+class TranspositionTable
+{
+public:
+	// capacity is rounded up to a power of two
+	explicit TranspositionTable(size_t capacity);
+
+	// Returns true if hash was not in the table before this call. When the
+	// probe window around hash is full the state is reported as new without
+	// being stored, so a full table costs duplicate work but never prunes a
+	// state that was not seen.
+	bool Insert(uint64_t hash);
+	bool Contains(uint64_t hash) const;
+
+	// Not safe while other threads insert
+	void Clear();
+
+	size_t GetCapacity() const { return mask + 1; }
+	size_t GetSize() const { return size.load(std::memory_order_relaxed); }
+	uint64_t GetOverflows() const { return overflows.load(std::memory_order_relaxed); }
+
+private:
+	static const unsigned int MAX_PROBES = 32;
+
+	size_t mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> slots; // 0 marks an empty slot
+	std::atomic<size_t> size{0};
+	std::atomic<uint64_t> overflows{0};
+};
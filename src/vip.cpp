@@ -0,0 +1,228 @@
+#include "vip.hpp"
+#include "analysis.hpp"
+
+// Machine cycles the VIP interpreter spends per instruction. These are
+// approximations of the published figures for the original interpreter,
+// close enough that ROMs written for the VIP run at their intended pace.
+const unsigned int FETCH_CYCLES = 40;		  // fetch, decode and dispatch
+const unsigned int SKIP_CYCLES = 4;			  // extra when a skip is taken
+const unsigned int CLS_CYCLES = 24 + 3078;	  // clearing 256 bytes of display RAM
+const unsigned int BCD_DIGIT_CYCLES = 16;	  // per subtraction in Fx33's digit loops
+const unsigned int REGISTER_COPY_CYCLES = 14; // per register in Fx55 and Fx65
+
+// Dxyn waits for the next interrupt and then draws row by row. A sprite that
+// is not byte aligned spans two display bytes and each row is shifted into
+// place one bit at a time.
+const unsigned int DRAW_SETUP_CYCLES = 26;
+const unsigned int DRAW_ROW_CYCLES = 34;
+const unsigned int DRAW_SPLIT_CYCLES = 12;
+const unsigned int DRAW_SHIFT_CYCLES = 8;
+
+// The interrupt arrives two display lines before DMA starts
+const unsigned int INTERRUPT_CYCLES = 46;
+const unsigned int INTERRUPT_LEAD_CYCLES = 2 * 14;
+const unsigned int DISPLAY_DMA_CYCLES = 128 * 8;
+
+// Table entries are a cost in the low bits and flags for the few opcodes
+// whose cost depends on the machine state
+const uint16_t COST_MASK = 0x0FFFu;
+const uint16_t COST_SKIP = 0x8000u;
+const uint16_t COST_DRAW = 0x4000u;
+const uint16_t COST_BCD = 0x2000u;
+
+static uint16_t costTable[0xFFFF + 1];
+static uint16_t drawRowCycles[8];
+
+static uint16_t OperationCost(uint16_t opcode)
+{
+	unsigned int x = (opcode & 0x0F00u) >> 8u;
+
+	switch (Decode(opcode))
+	{
+	case Operation::Null:
+		return FETCH_CYCLES;
+	case Operation::Cls:
+		return FETCH_CYCLES + CLS_CYCLES;
+	case Operation::Ret:
+		return FETCH_CYCLES + 10;
+	case Operation::Jp:
+		return FETCH_CYCLES + 12;
+	case Operation::Call:
+		return FETCH_CYCLES + 26;
+	case Operation::SeByte:
+	case Operation::SneByte:
+		return COST_SKIP | (FETCH_CYCLES + 10);
+	case Operation::SeReg:
+	case Operation::SneReg:
+		return COST_SKIP | (FETCH_CYCLES + 14);
+	case Operation::LdByte:
+		return FETCH_CYCLES + 6;
+	case Operation::AddByte:
+		return FETCH_CYCLES + 10;
+	case Operation::LdReg:
+	case Operation::Or:
+	case Operation::And:
+	case Operation::Xor:
+	case Operation::AddReg:
+	case Operation::Sub:
+	case Operation::Shr:
+	case Operation::Subn:
+	case Operation::Shl:
+		// The interpreter builds the ALU instruction in RAM and calls it
+		return FETCH_CYCLES + 44;
+	case Operation::LdI:
+		return FETCH_CYCLES + 12;
+	case Operation::JpV0:
+		return FETCH_CYCLES + 22;
+	case Operation::Rnd:
+		return FETCH_CYCLES + 36;
+	case Operation::Drw:
+		return COST_DRAW | (FETCH_CYCLES + DRAW_SETUP_CYCLES);
+	case Operation::Skp:
+	case Operation::Sknp:
+		return COST_SKIP | (FETCH_CYCLES + 14);
+	case Operation::LdVxDt:
+	case Operation::LdDtVx:
+	case Operation::LdStVx:
+		return FETCH_CYCLES + 10;
+	case Operation::LdVxK:
+		// Charged per poll, since the instruction runs again until a key is down
+		return FETCH_CYCLES + 20;
+	case Operation::AddI:
+		return FETCH_CYCLES + 16;
+	case Operation::LdF:
+		return FETCH_CYCLES + 20;
+	case Operation::LdB:
+		return COST_BCD | (FETCH_CYCLES + 84);
+	case Operation::StoreRegs:
+	case Operation::LoadRegs:
+		return FETCH_CYCLES + 14 + REGISTER_COPY_CYCLES * (x + 1);
+	}
+	return FETCH_CYCLES;
+}
+
+static bool BuildCostTables()
+{
+	for (unsigned int opcode = 0; opcode <= 0xFFFF; ++opcode)
+	{
+		costTable[opcode] = OperationCost(static_cast<uint16_t>(opcode));
+	}
+	for (unsigned int shift = 0; shift < 8; ++shift)
+	{
+		drawRowCycles[shift] = DRAW_ROW_CYCLES + (shift ? DRAW_SPLIT_CYCLES + shift * DRAW_SHIFT_CYCLES : 0);
+	}
+	return true;
+}
+
+VipTiming::VipTiming(Chip8 &chip8)
+	: chip8(chip8)
+{
+	// The tables are shared, only the first instance fills them in
+	static bool const tablesReady = BuildCostTables();
+	(void)tablesReady;
+
+	Schedule(VIP_CYCLES_PER_FRAME, VipEvent::Interrupt);
+	Schedule(VIP_CYCLES_PER_FRAME + INTERRUPT_LEAD_CYCLES, VipEvent::DisplayDma);
+}
+
+unsigned int VipTiming::BaseCost(uint16_t opcode)
+{
+	return OperationCost(opcode) & COST_MASK;
+}
+
+void VipTiming::Run(uint64_t machineCycles)
+{
+	deadline += machineCycles;
+	while (now < deadline)
+	{
+		Step();
+	}
+}
+
+void VipTiming::Step()
+{
+	uint16_t pc = chip8.pc;
+	uint16_t opcode = (chip8.memory[pc] << 8u) | chip8.memory[pc + 1];
+	uint16_t entry = costTable[opcode];
+	uint64_t cost = entry & COST_MASK;
+
+	if (entry & COST_DRAW)
+	{
+		// The interpreter draws during vertical blank, so it sits out the
+		// rest of the frame first
+		WaitForInterrupt();
+		uint8_t x = chip8.registers[(opcode & 0x0F00u) >> 8u];
+		cost += (opcode & 0x000Fu) * drawRowCycles[x & 7u];
+	}
+	else if (entry & COST_BCD)
+	{
+		uint8_t value = chip8.registers[(opcode & 0x0F00u) >> 8u];
+		cost += BCD_DIGIT_CYCLES * (value / 100 + value / 10 % 10 + value % 10);
+	}
+
+	chip8.FetchExecute();
+
+	if ((entry & COST_SKIP) && chip8.pc == static_cast<uint16_t>(pc + 4))
+	{
+		cost += SKIP_CYCLES;
+	}
+
+	now += cost;
+	++instructions;
+	if (now >= events[0].time)
+	{
+		FireEvents();
+	}
+}
+
+void VipTiming::Schedule(uint64_t time, VipEvent event)
+{
+	// Insertion sort from the back; ties keep the order they were scheduled in
+	unsigned int i = eventCount++;
+	for (; i > 0 && events[i - 1].time > time; --i)
+	{
+		events[i] = events[i - 1];
+	}
+	events[i] = {time, event};
+}
+
+void VipTiming::FireEvents()
+{
+	// Events that fall inside an instruction happen once it finishes. Their
+	// own cycles push the clock on, which may bring further events due.
+	while (eventCount > 0 && now >= events[0].time)
+	{
+		ScheduledEvent fired = events[0];
+		--eventCount;
+		for (unsigned int i = 0; i < eventCount; ++i)
+		{
+			events[i] = events[i + 1];
+		}
+
+		switch (fired.event)
+		{
+		case VipEvent::Interrupt:
+			chip8.TickTimers(1);
+			now += INTERRUPT_CYCLES;
+			++frames;
+			break;
+		case VipEvent::DisplayDma:
+			now += DISPLAY_DMA_CYCLES;
+			break;
+		}
+		Schedule(fired.time + VIP_CYCLES_PER_FRAME, fired.event);
+	}
+}
+
+void VipTiming::WaitForInterrupt()
+{
+	for (unsigned int i = 0; i < eventCount; ++i)
+	{
+		if (events[i].event == VipEvent::Interrupt)
+		{
+			now = now > events[i].time ? now : events[i].time;
+			break;
+		}
+	}
+	FireEvents();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstdint>
+
+// The COSMAC VIP's 1802 runs at 1.7609 MHz with 8 clocks per machine cycle,
+// and the 1861 display takes 14 machine cycles per line, 262 lines a frame
+const double VIP_MACHINE_CYCLES_PER_SECOND = 1760900.0 / 8.0;
+const unsigned int VIP_CYCLES_PER_FRAME = 14 * 262;
+
+// Runs a machine with the timing of the original VIP interpreter instead of
+// one instruction per cycle. Each instruction is charged the machine cycles
+// the interpreter spends on it, looked up in a table built once for all
+// 65536 opcodes; only skips, sprites and BCD add anything at run time.
+// Timer ticks and the display's cycle stealing happen as scheduled events,
+// so the timers count down at 60 Hz of machine time however fast or slow the
+// instructions in between are.
+class VipTiming
+{
+public:
+	explicit VipTiming(Chip8 &chip8);
+
+	// Run until machineCycles more machine cycles have passed. An instruction
+	// that runs past the end is finished, and the overshoot is taken off the
+	// next call, so many short calls keep the same pace as one long one.
+	void Run(uint64_t machineCycles);
+
+	// Machine cycles for an opcode not counting skips, sprite rows or BCD
+	// digits, for tools that want to show them
+	static unsigned int BaseCost(uint16_t opcode);
+
+	uint64_t GetMachineCycles() const { return now; }
+	uint64_t GetInstructions() const { return instructions; }
+	uint64_t GetFrames() const { return frames; }
+
+private:
+	enum class VipEvent : uint8_t
+	{
+		Interrupt, // 1861 interrupt: the handler ticks the timers
+		DisplayDma // 128 lines of 8 bytes each steal a machine cycle per byte
+	};
+	struct ScheduledEvent
+	{
+		uint64_t time;
+		VipEvent event;
+	};
+	static const unsigned int MAX_EVENTS = 4;
+
+	Chip8 &chip8;
+	uint64_t now{};
+	uint64_t deadline{};
+	uint64_t instructions{};
+	uint64_t frames{};
+
+	// Pending events, soonest first. There are only ever a handful, so a
+	// sorted array beats a heap; the hot path only compares with events[0].
+	ScheduledEvent events[MAX_EVENTS];
+	unsigned int eventCount{};
+
+	void Schedule(uint64_t time, VipEvent event);
+	void FireEvents();
+	void WaitForInterrupt();
+	void Step();
+};
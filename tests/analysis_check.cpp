@@ -0,0 +1,107 @@
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Control-flow recovery, data classification and self-modifying store
+// detection on a small hand-assembled ROM, plus a few decoder cases.
+
+// 0x200  2208  CALL 0x208
+// 0x202  3000  SE V0, 0x00
+// 0x204  1202  JP 0x202
+// 0x206  1206  JP 0x206
+// 0x208  A202  LD I, 0x202
+// 0x20A  F155  LD [I], V1     overwrites the SE at 0x202
+// 0x20C  A212  LD I, 0x212
+// 0x20E  D011  DRW V0, V1, 1
+// 0x210  00EE  RET
+// 0x212  FF                   sprite row, so data
+// 0x213  FF                   never read, so unknown
+static const uint8_t ROM[] = {0x22, 0x08, 0x30, 0x00, 0x12, 0x02, 0x12, 0x06, 0xA2, 0x02,
+                              0xF1, 0x55, 0xA2, 0x12, 0xD0, 0x11, 0x00, 0xEE, 0xFF, 0xFF};
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static bool Has(std::vector<uint16_t> const &values, uint16_t value)
+{
+    return std::find(values.begin(), values.end(), value) != values.end();
+}
+
+static void CheckBlocks(RomAnalysis const &analysis)
+{
+    Expect(analysis.GetBlocks().size() == 5, "five basic blocks");
+
+    BasicBlock const *entry = analysis.FindBlock(0x200);
+    Expect(entry && entry->exit == BlockExit::Call && entry->callTarget == 0x208 && entry->end == 0x202,
+           "entry block ends in a call to 0x208");
+
+    BasicBlock const *skip = analysis.FindBlock(0x202);
+    Expect(skip && skip->exit == BlockExit::Skip && Has(skip->successors, 0x204) && Has(skip->successors, 0x206),
+           "skip block has both successors");
+    Expect(skip && skip->selfModified, "skip block is marked self-modified");
+
+    BasicBlock const *loop = analysis.FindBlock(0x206);
+    Expect(loop && loop->exit == BlockExit::Jump && Has(loop->successors, 0x206), "jump to self");
+
+    BasicBlock const *callee = analysis.FindBlock(0x20A);
+    Expect(callee && callee->start == 0x208 && callee->exit == BlockExit::Return && callee->end == 0x212,
+           "FindBlock() finds the block containing an address");
+    Expect(callee && !callee->selfModified, "callee is not self-modified");
+}
+
+static void CheckFunctionsAndData(RomAnalysis const &analysis)
+{
+    auto const &functions = analysis.GetFunctions();
+    Expect(functions.size() == 2 && functions.count(0x200) && functions.count(0x208), "two functions");
+    Expect(functions.count(0x200) && Has(functions.at(0x200).callees, 0x208), "entry calls 0x208");
+
+    Expect(analysis.GetByteKind(0x210) == ByteKind::Code, "RET is code");
+    Expect(analysis.GetByteKind(0x212) == ByteKind::Data, "sprite drawn through Annn is data");
+    Expect(analysis.GetByteKind(0x213) == ByteKind::Unknown, "unreached byte that is never read is unknown");
+
+    auto const &writes = analysis.GetSelfModifyingWrites();
+    Expect(writes.size() == 1, "one self-modifying write");
+    if (!writes.empty())
+    {
+        Expect(writes[0].writer == 0x20A && writes[0].start == 0x202 && writes[0].length == 2 && writes[0].resolved,
+               "Fx55 resolved against the Annn before it");
+    }
+}
+
+static void CheckDecoder()
+{
+    Expect(Decode(0x0120) == Operation::Cls, "0x0120 decodes as CLS, as in the interpreter");
+    Expect(Decode(0x8008) == Operation::Null && !IsValidOpcode(0x8008), "8xy8 is invalid");
+    Expect(Disassemble(0xD125) == "DRW V1, V2, 5", "Dxyn disassembly");
+    Expect(Disassemble(0x2208) == "CALL 0x208", "2nnn disassembly");
+}
+
+int main()
+{
+    Chip8 chip8;
+    chip8.LoadRom(ROM, sizeof(ROM));
+    RomAnalysis analysis(chip8);
+
+    CheckBlocks(analysis);
+    CheckFunctionsAndData(analysis);
+    CheckDecoder();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "analysis checks passed\n";
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "arena.hpp"
+#include "chip8.hpp"
+#include <cstdlib>
+#include <iostream>
+
+// Chip8Arena slot bookkeeping, and forks taken from the arena running on
+// independently of the machine they were forked from.
+
+// 0x200  C0FF  RND V0, 0xFF
+// 0x202  A300  LD I, 0x300
+// 0x204  F055  LD [I], V0
+// 0x206  7101  ADD V1, 0x01
+// 0x208  1200  JP 0x200
+static const uint8_t ROM[] = {0xC0, 0xFF, 0xA3, 0x00, 0xF0, 0x55, 0x71, 0x01, 0x12, 0x00};
+
+const size_t CAPACITY = 3;
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static void CheckSlots()
+{
+    Chip8Arena arena(CAPACITY);
+    Expect(arena.GetCapacity() == CAPACITY && arena.GetFreeCount() == CAPACITY, "starts with every slot free");
+
+    Chip8 *machines[CAPACITY];
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        machines[i] = arena.Acquire();
+        Expect(machines[i] != nullptr, "Acquire() succeeds while slots are free");
+    }
+    Expect(machines[0] != machines[1] && machines[1] != machines[2] && machines[0] != machines[2],
+           "slots are distinct");
+    Expect(arena.Acquire() == nullptr && arena.GetFreeCount() == 0, "Acquire() fails when full");
+
+    Expect(arena.Release(machines[1]), "Release() succeeds");
+    Expect(!arena.Release(machines[1]), "a second Release() of the same slot is rejected");
+    Expect(arena.GetFreeCount() == 1, "a rejected Release() does not free another slot");
+
+    Expect(arena.Acquire() == machines[1], "a released slot is handed out again");
+    Expect(arena.Acquire() == nullptr, "the double release did not create a spare slot");
+}
+
+static void CheckForks()
+{
+    Chip8 original;
+    original.LoadRom(ROM, sizeof(ROM));
+    original.SeedRandom(7);
+    original.Run(101);
+
+    Chip8Arena arena(CAPACITY);
+    Chip8 *clone = arena.Fork(original);
+    Expect(clone && clone->SameState(original) && clone->StateHash() == original.StateHash(),
+           "Fork() copies the state and its hash");
+    if (!clone)
+    {
+        return;
+    }
+
+    // The RNG is forked too, so both draw the same numbers from here on
+    original.Run(500);
+    clone->Run(500);
+    Expect(clone->SameState(original) && clone->StateHash() == original.StateHash(),
+           "a fork keeps running in step with the original");
+
+    // Changes to one do not show up in the other
+    clone->Run(1);
+    Expect(!clone->SameState(original), "a fork is independent of the original");
+
+    // Forking into a slot overwrites whatever it was released with
+    Chip8 *again = arena.Fork(original);
+    arena.Release(clone);
+    Chip8 *reused = arena.Fork(original);
+    Expect(reused == clone && reused->SameState(original) && again->SameState(original),
+           "forking into a reused slot replaces its old state");
+}
+
+int main()
+{
+    CheckSlots();
+    CheckForks();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "arena checks passed\n";
+    return 0;
+}
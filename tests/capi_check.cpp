@@ -0,0 +1,117 @@
+#include "mayochip8.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// The C API as a host sees it: linked against libmayochip8 and using only
+// what mayochip8.h declares.
+
+// 0x200  6000  LD V0, 0x00
+// 0x202  F029  LD F, V0
+// 0x204  D005  DRW V0, V0, 5   draws the "0" glyph in the top left corner
+// 0x206  F10A  LD V1, K
+// 0x208  1208  JP 0x208
+static const uint8_t ROM[] = {0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0xF1, 0x0A, 0x12, 0x08};
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static void CheckLoading(mc8_machine *machine)
+{
+    Expect(mc8_api_version() == MC8_API_VERSION, "mc8_api_version() matches the header");
+
+    std::vector<uint8_t> tooLarge(MC8_MAX_ROM_SIZE + 1);
+    Expect(mc8_load_rom(machine, tooLarge.data(), tooLarge.size()) == -1, "an oversized ROM is rejected");
+    Expect(mc8_load_rom(machine, ROM, sizeof(ROM)) == 0, "the ROM loads");
+
+    const mc8_state_view *state = mc8_state(machine);
+    Expect(*state->pc == 0x200 && state->memory[0x200] == 0x60 && state->memory[0x209] == 0x08,
+           "the state view shows the loaded ROM");
+}
+
+static void CheckStepping(mc8_machine *machine)
+{
+    const mc8_state_view *state = mc8_state(machine);
+    const uint64_t *video = mc8_framebuffer(machine);
+
+    mc8_set_cycles_per_frame(machine, 3);
+    mc8_step_frames(machine, 1);
+    Expect(*state->pc == 0x206, "one frame runs cycles_per_frame instructions");
+    Expect(video[0] == 0xF0ull << 56u && video[1] == 0x90ull << 56u && video[5] == 0,
+           "the framebuffer shows the glyph with the leftmost pixel in the top bit");
+
+    // Fx0A waits until a key is held, then stores the lowest one
+    mc8_step_frames(machine, 4);
+    Expect(*state->pc == 0x206, "Fx0A waits with no key held");
+    mc8_set_keys(machine, 1u << 9u | 1u << 5u);
+    mc8_set_cycles_per_frame(machine, 1);
+    mc8_step_frames(machine, 1);
+    Expect(*state->pc == 0x208 && state->registers[1] == 5, "Fx0A takes the lowest held key");
+
+    uint64_t hash = mc8_state_hash(machine);
+    mc8_reset(machine);
+    Expect(*state->pc == 0x200 && state->registers[1] == 0 && video[0] == 0, "mc8_reset() clears the machine");
+    Expect(mc8_state_hash(machine) != hash, "the state hash follows the state");
+}
+
+static void CheckFork(mc8_machine *machine)
+{
+    mc8_set_cycles_per_frame(machine, 2);
+    mc8_step_frames(machine, 1);
+
+    mc8_machine *clone = mc8_fork(machine);
+    Expect(clone != nullptr, "mc8_fork() succeeds");
+    if (!clone)
+    {
+        return;
+    }
+    Expect(mc8_state(clone) != mc8_state(machine) && mc8_framebuffer(clone) != mc8_framebuffer(machine),
+           "a fork has its own state");
+    Expect(mc8_state_hash(clone) == mc8_state_hash(machine), "a fork starts with the same hash");
+
+    // The fork keeps cycles_per_frame, and stepping it leaves the original alone
+    mc8_step_frames(clone, 1);
+    Expect(*mc8_state(clone)->pc == 0x206 && *mc8_state(machine)->pc == 0x204, "a fork steps on its own");
+    mc8_step_frames(machine, 1);
+    Expect(mc8_state_hash(clone) == mc8_state_hash(machine), "the same steps give the same hash");
+    mc8_destroy(clone);
+}
+
+static void CheckStream(mc8_machine *machine)
+{
+    Expect(mc8_stream_open(machine, nullptr) == 0, "stopping a stream that was never opened succeeds");
+    Expect(mc8_stream_open(machine, "/nonexistent/mayochip8.sock") == -1, "an unusable socket path fails");
+    mc8_step_frames(machine, 1);
+}
+
+int main()
+{
+    mc8_machine *machine = mc8_create();
+    if (!machine)
+    {
+        std::cerr << "mc8_create() failed\n";
+        return EXIT_FAILURE;
+    }
+
+    CheckLoading(machine);
+    CheckStepping(machine);
+    CheckFork(machine);
+    CheckStream(machine);
+    mc8_destroy(machine);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "C API checks passed\n";
+    return 0;
+}
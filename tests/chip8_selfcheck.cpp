@@ -0,0 +1,189 @@
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include "fuzz.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Differential checks of the interpreter against itself on random ROMs:
+// fused Run() against one Cycle() at a time, the incremental StateHash()
+// against ComputeStateHash(), and Fork() and Reset() against fresh machines.
+// Each ROM only runs for as long as FuzzExecutor finds no fault, since past
+// a fault (stack overflow, memory past 4 KB) the interpreter's behaviour is
+// undefined rather than wrong.
+
+const unsigned int ROM_COUNT = 300;
+const unsigned int ROM_INSTRUCTIONS = 96;
+const uint64_t MAX_CYCLES = 2000;
+
+static uint16_t RandomOpcode(std::mt19937 &rng)
+{
+    uint16_t opcode;
+    do
+    {
+        opcode = static_cast<uint16_t>(rng());
+    } while (!IsValidOpcode(opcode));
+
+    // Keep jumps, calls and I inside the ROM most of the time, so that runs
+    // last longer than a few instructions
+    unsigned int top = opcode >> 12u;
+    if (top == 0x1 || top == 0x2 || top == 0xA || top == 0xB)
+    {
+        opcode = static_cast<uint16_t>((opcode & 0xF000u) | (ROM_START_ADDRESS + rng() % (ROM_INSTRUCTIONS * 2)));
+    }
+    return opcode;
+}
+
+// Random instructions, with the sequences the fusion rules look for mixed in
+static std::vector<uint8_t> RandomRom(std::mt19937 &rng)
+{
+    // Start both timers, so fused handlers that tick them get checked too
+    uint16_t timers = static_cast<uint16_t>(0x6000u | (rng() & 0xFFu));
+    std::vector<uint16_t> opcodes = {timers, 0xF015u, 0xF018u};
+    while (opcodes.size() < ROM_INSTRUCTIONS)
+    {
+        uint16_t address = static_cast<uint16_t>(ROM_START_ADDRESS + opcodes.size() * 2);
+        unsigned int x = rng() % 16;
+        unsigned int y = rng() % 16;
+        switch (rng() % 8)
+        {
+        case 0: // 6xkk 6xkk Dxyn
+            opcodes.push_back(static_cast<uint16_t>(0x6000u | x << 8u | (rng() & 0xFFu)));
+            opcodes.push_back(static_cast<uint16_t>(0x6000u | y << 8u | (rng() & 0xFFu)));
+            opcodes.push_back(static_cast<uint16_t>(0xD000u | x << 8u | y << 4u | (rng() % 16)));
+            break;
+        case 1: // Fx07 3xkk 1nnn, waiting on the delay timer
+            opcodes.push_back(static_cast<uint16_t>(0xF007u | x << 8u));
+            opcodes.push_back(static_cast<uint16_t>(0x3000u | x << 8u | (rng() % 4)));
+            opcodes.push_back(static_cast<uint16_t>(0x1000u | address));
+            break;
+        case 2: // Annn Fx65
+            opcodes.push_back(static_cast<uint16_t>(0xA000u | (ROM_START_ADDRESS + rng() % (ROM_INSTRUCTIONS * 2))));
+            opcodes.push_back(static_cast<uint16_t>(0xF065u | x << 8u));
+            break;
+        case 3: // 3xkk or 4xkk then 1nnn
+            opcodes.push_back(static_cast<uint16_t>((rng() % 2 ? 0x3000u : 0x4000u) | x << 8u | (rng() & 0xFFu)));
+            opcodes.push_back(static_cast<uint16_t>(0x1000u | (ROM_START_ADDRESS + rng() % (ROM_INSTRUCTIONS * 2))));
+            break;
+        default:
+            opcodes.push_back(RandomOpcode(rng));
+            break;
+        }
+    }
+
+    std::vector<uint8_t> rom;
+    for (uint16_t opcode : opcodes)
+    {
+        rom.push_back(static_cast<uint8_t>(opcode >> 8u));
+        rom.push_back(static_cast<uint8_t>(opcode & 0xFFu));
+    }
+    return rom;
+}
+
+static bool Fail(unsigned int romIndex, char const *what)
+{
+    std::cerr << "ROM " << romIndex << ": " << what << "\n";
+    return false;
+}
+
+static bool CheckRom(unsigned int romIndex, std::vector<uint8_t> const &rom, uint16_t keys)
+{
+    Chip8 initial;
+    initial.LoadRom(rom.data(), rom.size());
+    initial.SeedRandom(romIndex);
+    *initial.GetKeypad() = keys;
+
+    if (initial.StateHash() != initial.ComputeStateHash())
+    {
+        return Fail(romIndex, "StateHash() differs from ComputeStateHash() after loading");
+    }
+
+    // Only compare over the cycles the ROM runs without faulting
+    FuzzExecutor executor(initial, MAX_CYCLES);
+    uint64_t cycles = executor.Run({}).cycle;
+
+    Chip8 reference;
+    initial.Fork(reference);
+    Chip8 midway;
+    for (uint64_t i = 0; i < cycles; ++i)
+    {
+        if (i == cycles / 2)
+        {
+            reference.Fork(midway);
+        }
+        reference.Cycle();
+        if (reference.StateHash() != reference.ComputeStateHash())
+        {
+            return Fail(romIndex, "StateHash() differs from ComputeStateHash()");
+        }
+    }
+
+    // Fused, in one go and in uneven chunks that split superinstructions
+    Chip8 fused;
+    initial.Fork(fused);
+    fused.Run(cycles);
+    if (!fused.SameState(reference) || fused.StateHash() != reference.StateHash())
+    {
+        return Fail(romIndex, "Run() differs from Cycle()");
+    }
+
+    Chip8 chunked;
+    initial.Fork(chunked);
+    std::mt19937 rng(romIndex);
+    for (uint64_t left = cycles; left > 0;)
+    {
+        uint64_t chunk = 1 + rng() % 5;
+        chunk = chunk < left ? chunk : left;
+        chunked.Run(chunk);
+        left -= chunk;
+    }
+    if (!chunked.SameState(reference) || chunked.StateHash() != reference.StateHash())
+    {
+        return Fail(romIndex, "Run() in chunks differs from Cycle()");
+    }
+
+    // A fork taken halfway finishes in the same state as the original
+    if (cycles > 0)
+    {
+        for (uint64_t i = cycles / 2; i < cycles; ++i)
+        {
+            midway.Cycle();
+        }
+        if (!midway.SameState(reference) || midway.StateHash() != reference.StateHash())
+        {
+            return Fail(romIndex, "Fork() differs from the machine it was forked from");
+        }
+    }
+
+    // Reset() matches a freshly loaded machine, hash included
+    Chip8 fresh;
+    fresh.LoadRom(rom.data(), rom.size());
+    reference.Reset();
+    if (!reference.SameState(fresh) || reference.StateHash() != fresh.StateHash() ||
+        reference.StateHash() != reference.ComputeStateHash())
+    {
+        return Fail(romIndex, "Reset() differs from a fresh machine");
+    }
+    return true;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    unsigned int failures = 0;
+    for (unsigned int i = 0; i < ROM_COUNT; ++i)
+    {
+        std::vector<uint8_t> rom = RandomRom(rng);
+        uint16_t keys = static_cast<uint16_t>(rng() % 2 ? 1u << (rng() % KEYPAD_KEY_COUNT) : 0);
+        failures += CheckRom(i, rom, keys) ? 0 : 1;
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << ROM_COUNT << " ROMs failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "all " << ROM_COUNT << " ROMs consistent\n";
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Breakpoints, watchpoints, register conditions, StepOver and input replay
+// on a small hand-assembled ROM.
+
+const uint64_t MAX_CYCLES = 1000;
+
+// 0x200  6005  LD V0, 5
+// 0x202  A300  LD I, 0x300
+// 0x204  2210  CALL 0x210
+// 0x206  7001  ADD V0, 1
+// 0x208  E09E  SKP V0        waits for key 6
+// 0x20A  1208  JP 0x208
+// 0x20C  6107  LD V1, 7
+// 0x20E  120E  JP 0x20E
+// 0x210  F055  LD [I], V0
+// 0x212  00EE  RET
+static const uint8_t ROM[] = {0x60, 0x05, 0xA3, 0x00, 0x22, 0x10, 0x70, 0x01, 0xE0, 0x9E,
+                              0x12, 0x08, 0x61, 0x07, 0x12, 0x0E, 0xF0, 0x55, 0x00, 0xEE};
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static void Load(Chip8 &chip8)
+{
+    chip8.LoadRom(ROM, sizeof(ROM));
+}
+
+static std::string Registers(Debugger const &debugger)
+{
+    std::ostringstream out;
+    debugger.PrintRegisters(out);
+    return out.str();
+}
+
+static void CheckBreakpointsAndWatchpoints()
+{
+    Chip8 chip8;
+    Load(chip8);
+    Debugger debugger(chip8);
+    debugger.AddBreakpoint(0x206);
+    debugger.AddWatchpoint(0x300, 1, WatchKind::Write);
+
+    // The watchpoint stops before the store runs
+    Expect(debugger.Continue(MAX_CYCLES) == StopReason::WriteWatchpoint, "write watchpoint stops Continue()");
+    Expect(debugger.GetPc() == 0x210 && debugger.GetWatchAddress() == 0x300, "watchpoint stop location");
+    Expect(chip8.GetMemory()[0x300] == 0, "watched store has not run yet");
+
+    // Resuming does not stop on the same watchpoint again
+    Expect(debugger.Continue(MAX_CYCLES) == StopReason::Breakpoint, "breakpoint stops Continue()");
+    Expect(debugger.GetPc() == 0x206 && debugger.GetCycles() == 5, "breakpoint stop location");
+    Expect(chip8.GetMemory()[0x300] == 5, "watched store ran after resuming");
+
+    // A read watchpoint does not fire on writes
+    debugger.ClearAll();
+    debugger.AddWatchpoint(0x300, 1, WatchKind::Read);
+    Expect(debugger.Continue(20) == StopReason::CycleLimit, "read watchpoint ignores the loop");
+}
+
+static void CheckStepOver()
+{
+    Chip8 chip8;
+    Load(chip8);
+    Debugger debugger(chip8);
+
+    // Not a CALL, so a single step
+    Expect(debugger.StepOver(MAX_CYCLES) == StopReason::StepComplete && debugger.GetPc() == 0x202,
+           "StepOver() on a non-CALL steps once");
+    debugger.Step();
+
+    Expect(debugger.StepOver(MAX_CYCLES) == StopReason::StepComplete, "StepOver() returns after RET");
+    Expect(debugger.GetPc() == 0x206 && debugger.GetCycles() == 5, "StepOver() lands after the CALL");
+    Expect(chip8.GetMemory()[0x300] == 5, "StepOver() ran the subroutine");
+
+    // A breakpoint inside the subroutine still stops it
+    Chip8 again;
+    Load(again);
+    Debugger inner(again);
+    inner.Step();
+    inner.Step();
+    inner.AddBreakpoint(0x212);
+    Expect(inner.StepOver(MAX_CYCLES) == StopReason::Breakpoint && inner.GetPc() == 0x212,
+           "StepOver() stops at a breakpoint in the subroutine");
+}
+
+static void CheckConditionsAndInput()
+{
+    Chip8 chip8;
+    Load(chip8);
+    Debugger debugger(chip8);
+    debugger.AddRegisterCondition({0x0, RegisterCompare::Equal, 6});
+    Expect(debugger.Continue(MAX_CYCLES) == StopReason::RegisterCondition, "register condition stops Continue()");
+    Expect(debugger.GetPc() == 0x208 && Registers(debugger).find("V0=06") != std::string::npos,
+           "register condition stops after the instruction");
+
+    // Key 6 goes down at cycle 40, so SKP falls through on the first check
+    // after that
+    debugger.ClearAll();
+    debugger.SetInput({{40, 1u << 6u}});
+    debugger.AddBreakpoint(0x20C);
+    Expect(debugger.Continue(MAX_CYCLES) == StopReason::Breakpoint, "input script releases the key wait");
+    Expect(debugger.GetCycles() == 41, "key wait ends at the scripted cycle");
+}
+
+static void CheckStreamState()
+{
+    Chip8 chip8;
+    Load(chip8);
+    Debugger debugger(chip8);
+
+    // The printers leave the caller's fill and base alone
+    std::ostringstream out;
+    debugger.PrintRegisters(out);
+    debugger.PrintStack(out);
+    debugger.PrintIndex(out);
+    out.str("");
+    out << std::setw(3) << 10;
+    Expect(out.str() == " 10", "printers restore the stream state");
+}
+
+int main()
+{
+    CheckBreakpointsAndWatchpoints();
+    CheckStepOver();
+    CheckConditionsAndInput();
+    CheckStreamState();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "debugger checks passed\n";
+    return 0;
+}
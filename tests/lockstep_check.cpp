@@ -0,0 +1,167 @@
+#include "chip8.hpp"
+#include "lockstep.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// LockstepHarness on matching backends, with and without input, and on
+// candidates that go wrong: one that skips an instruction in a given state,
+// which has to be pinned to the chunk it happened in, and one whose bug does
+// not come back when replayed.
+
+// 0x200  A300  LD I, 0x300
+// 0x202  7101  ADD V1, 0x01
+// 0x204  F133  LD B, V1        digits of the counter at 0x300-0x302
+// 0x206  E29E  SKP V2          key 0
+// 0x208  1202  JP 0x202
+// 0x20A  7310  ADD V3, 0x10
+// 0x20C  1202  JP 0x202
+static const uint8_t ROM[] = {0xA3, 0x00, 0x71, 0x01, 0xF1, 0x33, 0xE2, 0x9E, 0x12, 0x02, 0x73, 0x10, 0x12, 0x02};
+
+const uint64_t CYCLES = 20000;
+const unsigned int BUDGET = 16;
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static LockstepBackend Interpreter()
+{
+    return {"interpreter", [](Chip8 &chip8, unsigned int)
+            {
+                chip8.Cycle();
+                return 1u;
+            }};
+}
+
+static LockstepBackend Fused()
+{
+    return {"fused", [](Chip8 &chip8, unsigned int budget) { return chip8.Step(budget); }};
+}
+
+static void CheckMatching(Chip8 const &initial)
+{
+    std::vector<InputEvent> input = {{100, 0x0001}, {137, 0x0000}, {5000, 0x0001}, {5001, 0x0000}};
+
+    LockstepHarness harness(Interpreter(), Fused(), initial);
+    harness.SetInput(input);
+    harness.SetBudget(BUDGET);
+    harness.SetFullCheckInterval(1000);
+    Expect(harness.Run(CYCLES / 2) && harness.Run(CYCLES / 2), "interpreter and fused match");
+    Expect(harness.GetCycles() == CYCLES, "Run() counts cycles across calls");
+    Expect(harness.GetFullChecks() >= CYCLES / 1000, "full comparisons run at the interval");
+
+    // The harness applies input at the same cycles as a hand-driven machine
+    Chip8 expected;
+    initial.Fork(expected);
+    size_t next = 0;
+    for (uint64_t cycle = 0; cycle < CYCLES; ++cycle)
+    {
+        while (next < input.size() && input[next].cycle <= cycle)
+        {
+            *expected.GetKeypad() = input[next++].keys;
+        }
+        expected.Cycle();
+    }
+    Expect(harness.GetStateHash() == expected.StateHash(), "input lands on the scripted cycles");
+
+    LockstepHarness noInput(Interpreter(), Fused(), initial);
+    noInput.Run(CYCLES);
+    Expect(noInput.GetStateHash() != harness.GetStateHash(), "input changes the outcome");
+}
+
+static void CheckDivergence(Chip8 const &initial)
+{
+    // The instruction that first leaves the counter in the 30s
+    Chip8 reference;
+    initial.Fork(reference);
+    uint64_t firstBad = 0;
+    for (reference.Cycle(); reference.GetMemory()[0x301] != 3; reference.Cycle())
+    {
+        ++firstBad;
+    }
+
+    // Runs whole chunks, but counts two instructions as one whenever the
+    // counter is in the 30s
+    LockstepBackend skipping = {"skipping", [](Chip8 &chip8, unsigned int budget)
+                                {
+                                    for (unsigned int i = 0; i < budget; ++i)
+                                    {
+                                        chip8.Cycle();
+                                        if (chip8.GetMemory()[0x301] == 3)
+                                        {
+                                            chip8.Cycle();
+                                        }
+                                    }
+                                    return budget;
+                                }};
+
+    LockstepHarness harness(Interpreter(), skipping, initial);
+    harness.SetBudget(BUDGET);
+    harness.SetFullCheckInterval(64);
+    Expect(!harness.Run(CYCLES), "a skipped instruction is a divergence");
+
+    Divergence const &divergence = harness.GetDivergence();
+    Expect(divergence.cycle <= firstBad && firstBad < divergence.cycle + divergence.opcodes.size(),
+           "the reported chunk contains the first bad cycle");
+    Expect(divergence.opcodes.size() == divergence.addresses.size() && divergence.opcodes.size() <= BUDGET,
+           "the chunk's instructions are listed");
+
+    bool pcDiffers = false;
+    for (std::string const &line : divergence.differences)
+    {
+        pcDiffers |= line.compare(0, 3, "pc:") == 0;
+    }
+    Expect(pcDiffers, "the report names the pc");
+}
+
+static void CheckNondeterministic(Chip8 const &initial)
+{
+    // Misbehaves only the first time it gets past cycle 300, so a replay from
+    // the checkpoint runs clean
+    uint64_t calls = 0;
+    LockstepBackend flaky = {"flaky", [&calls](Chip8 &chip8, unsigned int)
+                             {
+                                 chip8.Cycle();
+                                 if (++calls == 300)
+                                 {
+                                     chip8.Cycle();
+                                 }
+                                 return 1u;
+                             }};
+
+    LockstepHarness harness(Interpreter(), flaky, initial);
+    harness.SetBudget(BUDGET);
+    Expect(!harness.Run(CYCLES), "the first mismatch is still reported");
+    Divergence const &divergence = harness.GetDivergence();
+    Expect(divergence.differences.size() == 1 &&
+               divergence.differences[0].find("did not reproduce") != std::string::npos,
+           "a mismatch that does not reproduce is called out");
+}
+
+int main()
+{
+    Chip8 initial;
+    initial.LoadRom(ROM, sizeof(ROM));
+    initial.SeedRandom(3);
+
+    CheckMatching(initial);
+    CheckDivergence(initial);
+    CheckNondeterministic(initial);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "lockstep checks passed\n";
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "stream.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+// Frame encoding round trips, and a live FrameStreamer with one viewer that
+// stops reading for a while: frames it misses are dropped rather than
+// queued, and the next frame it can take is a keyframe that brings its image
+// back in line.
+
+const char SOCKET_PATH[] = "chip8stream_check.sock";
+const unsigned int MAX_PUBLISHES = 100000;
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static void RandomFrame(std::mt19937_64 &rng, uint64_t *rows, unsigned int changedRows)
+{
+    for (unsigned int i = 0; i < changedRows; ++i)
+    {
+        rows[rng() % VIDEO_HEIGHT] = rng();
+    }
+}
+
+static void CheckEncoding()
+{
+    std::mt19937_64 rng(1);
+    uint64_t rows[VIDEO_HEIGHT]{};
+    RandomFrame(rng, rows, 12);
+    rows[3] = 0;
+    rows[4] = 1;
+
+    uint8_t image[STREAM_FRAME_BYTES];
+    EncodeFrameRows(rows, image);
+    Expect(image[0] == static_cast<uint8_t>(rows[0] >> 56u) && image[8 * 4 + 7] == 1,
+           "rows are stored big-endian, x = 0 first");
+    uint64_t decoded[VIDEO_HEIGHT];
+    DecodeFrameRows(image, decoded);
+    Expect(std::memcmp(decoded, rows, sizeof(rows)) == 0, "DecodeFrameRows() undoes EncodeFrameRows()");
+
+    std::vector<uint8_t> packet;
+    EncodeStreamPacket(STREAM_KEYFRAME, 0x01020304, image, packet);
+    size_t length = packet[8] | packet[9] << 8u;
+    Expect(packet[0] == 'C' && packet[1] == '8' && packet[2] == STREAM_KEYFRAME && packet[4] == 0x04 &&
+               packet[7] == 0x01 && packet.size() == STREAM_HEADER_SIZE + length,
+           "packet header");
+
+    uint8_t rebuilt[STREAM_FRAME_BYTES]{};
+    Expect(ApplyStreamPayload(packet.data() + STREAM_HEADER_SIZE, length, rebuilt) &&
+               std::memcmp(rebuilt, image, sizeof(image)) == 0,
+           "a keyframe payload applied to a blank image rebuilds the frame");
+
+    // A one-row change encodes to a few bytes and applies as an XOR
+    uint8_t delta[STREAM_FRAME_BYTES]{};
+    delta[100] = 0x81;
+    delta[101] = 0x18;
+    EncodeStreamPacket(STREAM_DELTA, 1, delta, packet);
+    length = packet[8] | packet[9] << 8u;
+    Expect(length == 4, "a small delta stays small");
+    Expect(ApplyStreamPayload(packet.data() + STREAM_HEADER_SIZE, length, rebuilt) &&
+               rebuilt[100] == (image[100] ^ 0x81) && rebuilt[101] == (image[101] ^ 0x18),
+           "a delta payload XORs into the image");
+
+    // Truncated or oversized payloads are rejected
+    uint8_t truncated[] = {0, 5, 1, 2};
+    Expect(!ApplyStreamPayload(truncated, sizeof(truncated), rebuilt), "a truncated payload is rejected");
+    uint8_t pastEnd[] = {255, 2, 1, 1};
+    Expect(!ApplyStreamPayload(pastEnd, sizeof(pastEnd), rebuilt), "a payload past the frame is rejected");
+}
+
+// Reads whatever the streamer has sent so far and applies every complete
+// packet the way chip8watch does
+struct Viewer
+{
+    int fd{-1};
+    std::vector<uint8_t> buffered;
+    uint8_t image[STREAM_FRAME_BYTES]{};
+    bool synced{};
+    bool valid{true};
+    unsigned int keyframes{};
+    uint8_t lastType{};
+
+    bool Connect()
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, SOCKET_PATH);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        return fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    }
+
+    void Drain()
+    {
+        uint8_t chunk[4096];
+        ssize_t got;
+        while ((got = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0)
+        {
+            buffered.insert(buffered.end(), chunk, chunk + got);
+        }
+
+        size_t pos = 0;
+        while (buffered.size() - pos >= STREAM_HEADER_SIZE)
+        {
+            uint8_t const *header = buffered.data() + pos;
+            size_t length = header[8] | header[9] << 8u;
+            if (buffered.size() - pos < STREAM_HEADER_SIZE + length)
+            {
+                break;
+            }
+            valid &= header[0] == 'C' && header[1] == '8';
+            lastType = header[2];
+            if (lastType == STREAM_KEYFRAME)
+            {
+                std::memset(image, 0, sizeof(image));
+                synced = true;
+                ++keyframes;
+            }
+            if (synced)
+            {
+                valid &= ApplyStreamPayload(header + STREAM_HEADER_SIZE, length, image);
+            }
+            pos += STREAM_HEADER_SIZE + length;
+        }
+        buffered.erase(buffered.begin(), buffered.begin() + static_cast<std::ptrdiff_t>(pos));
+    }
+
+    bool Shows(uint64_t const *rows) const
+    {
+        uint8_t expected[STREAM_FRAME_BYTES];
+        EncodeFrameRows(rows, expected);
+        return synced && std::memcmp(image, expected, sizeof(image)) == 0;
+    }
+};
+
+static void CheckStreaming()
+{
+    FrameStreamer streamer(SOCKET_PATH);
+    Expect(streamer.IsOpen(), "the streamer listens");
+    if (!streamer.IsOpen())
+    {
+        return;
+    }
+
+    Viewer viewer;
+    Expect(viewer.Connect(), "a viewer connects");
+
+    std::mt19937_64 rng(2);
+    uint64_t rows[VIDEO_HEIGHT]{};
+    RandomFrame(rng, rows, 4);
+    streamer.Publish(rows);
+    Expect(streamer.GetSubscriberCount() == 1, "the viewer is accepted on the next frame");
+    viewer.Drain();
+    Expect(viewer.keyframes == 1 && viewer.Shows(rows), "a new viewer starts with a keyframe");
+
+    RandomFrame(rng, rows, 2);
+    streamer.Publish(rows);
+    viewer.Drain();
+    Expect(viewer.lastType == STREAM_DELTA && viewer.Shows(rows), "later frames arrive as deltas");
+
+    // Stop reading until the socket fills up and frames are dropped
+    unsigned int published = 0;
+    while (streamer.GetDroppedFrames() == 0 && published < MAX_PUBLISHES)
+    {
+        RandomFrame(rng, rows, VIDEO_HEIGHT);
+        streamer.Publish(rows);
+        ++published;
+    }
+    Expect(streamer.GetDroppedFrames() > 0, "a viewer that stops reading misses frames");
+
+    // Catch up: whatever was queued, plus the rest of any packet cut short,
+    // then a keyframe of the frame published after that
+    viewer.Drain();
+    unsigned int keyframesBefore = viewer.keyframes;
+    RandomFrame(rng, rows, 3);
+    streamer.Publish(rows);
+    viewer.Drain();
+    Expect(viewer.valid, "every packet parsed and applied");
+    Expect(viewer.keyframes > keyframesBefore && viewer.Shows(rows), "a keyframe brings the viewer back in line");
+
+    close(viewer.fd);
+    RandomFrame(rng, rows, 1);
+    streamer.Publish(rows);
+    Expect(streamer.GetSubscriberCount() == 0, "a viewer that hangs up is removed");
+}
+
+int main()
+{
+    CheckEncoding();
+    CheckStreaming();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "stream checks passed\n";
+    return 0;
+}
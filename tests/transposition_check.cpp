@@ -0,0 +1,132 @@
+#include "chip8.hpp"
+#include "transposition.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// TranspositionTable on its own, from many threads at once, and with the
+// StateHash() values of a machine that comes back round to an earlier state.
+
+const unsigned int THREAD_COUNT = 4;
+const uint64_t HASHES_PER_THREAD = 20000;
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static void CheckBasics()
+{
+    TranspositionTable table(100);
+    Expect(table.GetCapacity() == 128, "capacity is rounded up to a power of two");
+
+    Expect(table.Insert(42) && !table.Insert(42), "a hash is new only the first time");
+    Expect(table.Contains(42) && !table.Contains(43), "Contains() finds inserted hashes only");
+
+    // 0 is the empty marker, but a state can still hash to it
+    Expect(!table.Contains(0) && table.Insert(0) && !table.Insert(0) && table.Contains(0), "a zero hash is stored");
+    Expect(table.GetSize() == 2, "size counts distinct hashes");
+
+    table.Clear();
+    Expect(table.GetSize() == 0 && !table.Contains(42) && table.Insert(42), "Clear() empties the table");
+}
+
+static void CheckOverflow()
+{
+    // Every hash starts probing at the same slot, so the window fills up
+    TranspositionTable table(1024);
+    unsigned int stored = 0;
+    for (uint64_t i = 1; i <= 40; ++i)
+    {
+        stored += table.Insert(i * 1024) ? 1 : 0;
+    }
+    Expect(stored == 40, "every hash is reported new, stored or not");
+    Expect(table.GetOverflows() > 0 && table.GetSize() + table.GetOverflows() == 40,
+           "hashes past a full probe window are counted as overflows");
+    Expect(table.Contains(1024) && !table.Contains(40 * 1024), "overflowed hashes are not stored");
+}
+
+static void CheckThreads()
+{
+    // Each thread inserts its own range plus the one shared by every thread;
+    // every distinct hash must be reported new exactly once
+    TranspositionTable table(1 << 18);
+    std::atomic<uint64_t> reportedNew{0};
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < THREAD_COUNT; ++t)
+    {
+        threads.emplace_back(
+            [&table, &reportedNew, t]()
+            {
+                uint64_t found = 0;
+                for (uint64_t i = 0; i < HASHES_PER_THREAD; ++i)
+                {
+                    uint64_t shared = (i + 1) * 0x9E3779B97F4A7C15ull;
+                    uint64_t own = (t + 1) * 0xD1B54A32D192ED03ull + i * 0xBF58476D1CE4E5B9ull;
+                    found += table.Insert(shared) ? 1 : 0;
+                    found += table.Insert(own) ? 1 : 0;
+                }
+                reportedNew += found;
+            });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    uint64_t distinct = HASHES_PER_THREAD * (THREAD_COUNT + 1);
+    Expect(table.GetOverflows() == 0, "no overflows at a low load");
+    Expect(reportedNew == distinct && table.GetSize() == distinct, "each hash is new to exactly one thread");
+}
+
+static void CheckStates()
+{
+    // 0x200  7101  ADD V1, 0x01
+    // 0x202  1200  JP 0x200
+    // V1 wraps after 256 rounds, back to the state it started in
+    static const uint8_t ROM[] = {0x71, 0x01, 0x12, 0x00};
+    const unsigned int PERIOD = 2 * 256;
+
+    Chip8 chip8;
+    chip8.LoadRom(ROM, sizeof(ROM));
+    TranspositionTable table(4096);
+    unsigned int fresh = 0;
+    for (unsigned int cycle = 0; cycle < PERIOD; ++cycle)
+    {
+        fresh += table.Insert(chip8.StateHash()) ? 1 : 0;
+        chip8.Cycle();
+    }
+    Expect(fresh == PERIOD, "every state in one period is new");
+    Expect(!table.Insert(chip8.StateHash()), "the start state is found again a period later");
+
+    // A machine with the same registers and pc but different memory is a
+    // different state
+    static const uint8_t other[] = {0x71, 0x01, 0x12, 0x00, 0xFF};
+    Chip8 different;
+    different.LoadRom(other, sizeof(other));
+    Expect(table.Insert(different.StateHash()), "a memory difference makes a new state");
+}
+
+int main()
+{
+    CheckBasics();
+    CheckOverflow();
+    CheckThreads();
+    CheckStates();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "transposition checks passed\n";
+    return 0;
+}
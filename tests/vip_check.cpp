@@ -0,0 +1,127 @@
+#include "chip8.hpp"
+#include "vip.hpp"
+#include <cstdlib>
+#include <iostream>
+
+// VipTiming: timers tick at 60 Hz of machine time however slow the
+// instructions are, Dxyn waits for the display interrupt, and many short
+// runs keep the same pace as one long one.
+
+const uint64_t SECOND = 60 * VIP_CYCLES_PER_FRAME;
+
+static unsigned int failures = 0;
+
+static void Expect(bool condition, char const *what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+// 0x200  603C  LD V0, 60
+// 0x202  F015  LD DT, V0
+// 0x204  A300  LD I, 0x300
+// 0x206  F107  LD V1, DT
+// 0x208  F133  LD B, V1       digits of the last DT read at 0x300-0x302
+// 0x20A  ....  filler, 00E0 (slow) or 6000 (fast)
+// 0x20C  1206  JP 0x206
+static unsigned int DelayTimerAfter(uint8_t fillerHigh, uint8_t fillerLow, uint64_t machineCycles)
+{
+    uint8_t const rom[] = {0x60, 0x3C, 0xF0, 0x15, 0xA3, 0x00, 0xF1, 0x07,
+                           0xF1, 0x33, fillerHigh, fillerLow, 0x12, 0x06};
+    Chip8 chip8;
+    chip8.LoadRom(rom, sizeof(rom));
+    VipTiming timing(chip8);
+    timing.Run(machineCycles);
+
+    uint8_t const *memory = chip8.GetMemory();
+    return memory[0x300] * 100u + memory[0x301] * 10u + memory[0x302];
+}
+
+static void CheckTimers()
+{
+    // Half a second in, DT has ticked about 30 times whether the loop spends
+    // most of its time clearing the screen or not. The slow loop reads DT
+    // about once a frame, so its last read can lag by a tick or two.
+    unsigned int fast = DelayTimerAfter(0x60, 0x00, SECOND / 2);
+    unsigned int slow = DelayTimerAfter(0x00, 0xE0, SECOND / 2);
+    Expect(fast >= 29 && fast <= 31, "DT ticks at 60 Hz with fast instructions");
+    Expect(slow >= 29 && slow <= 32, "DT ticks at 60 Hz with slow instructions");
+
+    Expect(DelayTimerAfter(0x60, 0x00, SECOND + VIP_CYCLES_PER_FRAME) == 0, "DT reaches 0 after a second");
+    Expect(DelayTimerAfter(0x00, 0xE0, SECOND + 3 * VIP_CYCLES_PER_FRAME) == 0,
+           "DT reaches 0 after a second with slow instructions");
+}
+
+static void CheckDrawWaits()
+{
+    // 0x200  D011  DRW V0, V1, 1
+    // 0x202  1200  JP 0x200
+    static const uint8_t ROM[] = {0xD0, 0x11, 0x12, 0x00};
+    Chip8 chip8;
+    chip8.LoadRom(ROM, sizeof(ROM));
+    VipTiming timing(chip8);
+    timing.Run(SECOND);
+
+    Expect(timing.GetFrames() == 60, "60 frames a second");
+    Expect(timing.GetInstructions() >= 118 && timing.GetInstructions() <= 122,
+           "each sprite waits for the next frame");
+}
+
+static void CheckPacing()
+{
+    // 0x200  8014  ADD V0, V1
+    // 0x202  7101  ADD V1, 0x01
+    // 0x204  3100  SE V1, 0x00
+    // 0x206  1200  JP 0x200
+    // 0x208  00E0  CLS
+    // 0x20A  1200  JP 0x200
+    static const uint8_t ROM[] = {0x80, 0x14, 0x71, 0x01, 0x31, 0x00, 0x12, 0x00, 0x00, 0xE0, 0x12, 0x00};
+
+    Chip8 once;
+    once.LoadRom(ROM, sizeof(ROM));
+    Chip8 chunked;
+    once.Fork(chunked);
+
+    VipTiming onceTiming(once);
+    onceTiming.Run(SECOND);
+    VipTiming chunkedTiming(chunked);
+    for (uint64_t left = SECOND; left > 0;)
+    {
+        uint64_t chunk = left < 7 ? left : 7;
+        chunkedTiming.Run(chunk);
+        left -= chunk;
+    }
+
+    Expect(chunkedTiming.GetMachineCycles() == onceTiming.GetMachineCycles() &&
+               chunkedTiming.GetInstructions() == onceTiming.GetInstructions() && chunked.SameState(once),
+           "short runs keep the same pace as one long run");
+    Expect(onceTiming.GetMachineCycles() >= SECOND &&
+               onceTiming.GetMachineCycles() < SECOND + VipTiming::BaseCost(0x00E0) + VIP_CYCLES_PER_FRAME,
+           "Run() stops at the first instruction boundary past the deadline");
+}
+
+static void CheckCosts()
+{
+    Expect(VipTiming::BaseCost(0x00E0) > VipTiming::BaseCost(0x1200), "CLS costs more than JP");
+    Expect(VipTiming::BaseCost(0xFF55) > VipTiming::BaseCost(0xF055), "Fx55 costs more per register");
+    Expect(VipTiming::BaseCost(0x8014) > VipTiming::BaseCost(0x6000), "ALU ops cost more than loads");
+}
+
+int main()
+{
+    CheckTimers();
+    CheckDrawWaits();
+    CheckPacing();
+    CheckCosts();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "VIP timing checks passed\n";
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Translate a ROM into a C++ translation unit that exports an AotProgram.
+// Every basic block found by RomAnalysis becomes one function operating on an
+// AotContext. Blocks that the ROM may overwrite are left to the interpreter,
+// and blocks are split after each Fx33/Fx55 so that a store into the rest of
+// the same block is caught by the host's byte check before it runs.
+
+struct Segment
+{
+    uint16_t start;
+    uint16_t end;
+};
+
+static std::string Hex(unsigned int value)
+{
+    char text[16];
+    std::snprintf(text, sizeof(text), "0x%X", value);
+    return text;
+}
+
+static void FlushTicks(std::ostream &out, unsigned int &pending)
+{
+    if (pending > 0)
+    {
+        out << "\tc.Tick(" << pending << ");\n";
+        pending = 0;
+    }
+}
+
+// Emit one instruction. Returns true if the instruction set pc itself.
+static bool EmitInstruction(std::ostream &out, uint16_t address, uint16_t opcode, unsigned int &pending)
+{
+    std::string x = Hex((opcode & 0x0F00u) >> 8u);
+    std::string y = Hex((opcode & 0x00F0u) >> 4u);
+    std::string kk = Hex(opcode & 0x00FFu);
+    std::string nnn = Hex(opcode & 0x0FFFu);
+    std::string next = Hex(address + 2);
+    std::string skip = Hex(address + 4);
+    bool setsPc = false;
+
+    out << "\t// " << Hex(address) << ": " << Disassemble(opcode) << "\n";
+
+    switch (Decode(opcode))
+    {
+    case Operation::LdByte:
+        out << "\tc.SetV(" << x << ", " << kk << ");\n";
+        break;
+    case Operation::AddByte:
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") + " << kk << ");\n";
+        break;
+    case Operation::LdReg:
+        out << "\tc.SetV(" << x << ", c.V(" << y << "));\n";
+        break;
+    case Operation::Or:
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") | c.V(" << y << "));\n";
+        break;
+    case Operation::And:
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") & c.V(" << y << "));\n";
+        break;
+    case Operation::Xor:
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") ^ c.V(" << y << "));\n";
+        break;
+    case Operation::AddReg:
+        out << "\t{\n";
+        out << "\t\tunsigned int sum = c.V(" << x << ") + c.V(" << y << ");\n";
+        out << "\t\tc.SetV(0xF, sum > 255u);\n";
+        out << "\t\tc.SetV(" << x << ", sum & 0xFFu);\n";
+        out << "\t}\n";
+        break;
+    case Operation::Sub:
+        out << "\tc.SetV(0xF, c.V(" << x << ") > c.V(" << y << "));\n";
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") - c.V(" << y << "));\n";
+        break;
+    case Operation::Shr:
+        out << "\tc.SetV(0xF, c.V(" << x << ") & 0x1u);\n";
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") >> 1u);\n";
+        break;
+    case Operation::Subn:
+        out << "\tc.SetV(0xF, c.V(" << y << ") > c.V(" << x << "));\n";
+        out << "\tc.SetV(" << x << ", c.V(" << y << ") - c.V(" << x << "));\n";
+        break;
+    case Operation::Shl:
+        out << "\tc.SetV(0xF, (c.V(" << x << ") & 0x80u) >> 7u);\n";
+        out << "\tc.SetV(" << x << ", c.V(" << x << ") << 1u);\n";
+        break;
+    case Operation::LdI:
+        out << "\tc.SetI(" << nnn << ");\n";
+        break;
+    case Operation::AddI:
+        out << "\tc.SetI(c.I() + c.V(" << x << "));\n";
+        break;
+    case Operation::LdVxDt:
+        FlushTicks(out, pending);
+        out << "\tc.SetV(" << x << ", c.DelayTimer());\n";
+        break;
+    case Operation::LdDtVx:
+        FlushTicks(out, pending);
+        out << "\tc.SetDelayTimer(c.V(" << x << "));\n";
+        break;
+    case Operation::LdStVx:
+        FlushTicks(out, pending);
+        out << "\tc.SetSoundTimer(c.V(" << x << "));\n";
+        break;
+    case Operation::Jp:
+        out << "\tc.SetPc(" << nnn << ");\n";
+        setsPc = true;
+        break;
+    case Operation::JpV0:
+        out << "\tc.SetPc(c.V(0x0) + " << nnn << ");\n";
+        setsPc = true;
+        break;
+    case Operation::SeByte:
+        out << "\tc.SetPc(c.V(" << x << ") == " << kk << " ? " << skip << " : " << next << ");\n";
+        setsPc = true;
+        break;
+    case Operation::SneByte:
+        out << "\tc.SetPc(c.V(" << x << ") != " << kk << " ? " << skip << " : " << next << ");\n";
+        setsPc = true;
+        break;
+    case Operation::SeReg:
+        out << "\tc.SetPc(c.V(" << x << ") == c.V(" << y << ") ? " << skip << " : " << next << ");\n";
+        setsPc = true;
+        break;
+    case Operation::SneReg:
+        out << "\tc.SetPc(c.V(" << x << ") != c.V(" << y << ") ? " << skip << " : " << next << ");\n";
+        setsPc = true;
+        break;
+    default:
+        // Everything touching memory, video, the stack, the keypad or the RNG
+        // goes through the interpreter's own handler, which also leaves pc
+        // correct for calls, returns, key skips and Fx0A
+        out << "\tc.Exec(" << Hex(opcode) << ", " << next << ");\n";
+        setsPc = true;
+        break;
+    }
+
+    ++pending;
+    return setsPc;
+}
+
+static std::vector<Segment> SplitBlock(RomAnalysis const &analysis, BasicBlock const &block)
+{
+    std::vector<Segment> segments;
+    uint16_t start = block.start;
+
+    for (uint16_t address = block.start; address < block.end; address += 2)
+    {
+        Operation operation = Decode(analysis.GetOpcode(address));
+        bool store = operation == Operation::LdB || operation == Operation::StoreRegs;
+        if (store && address + 2 < block.end)
+        {
+            segments.push_back({start, static_cast<uint16_t>(address + 2)});
+            start = address + 2;
+        }
+    }
+    segments.push_back({start, block.end});
+    return segments;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> <Output.cpp>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    Chip8 chip8;
+    chip8.LoadRom(argv[1]);
+    if (chip8.GetRomSize() == 0)
+    {
+        std::cerr << "Could not read ROM " << argv[1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    RomAnalysis analysis(chip8);
+    std::ostringstream functions;
+    std::ostringstream table;
+    unsigned int blockCount = 0;
+    unsigned int skipped = 0;
+
+    for (auto const &entry : analysis.GetBlocks())
+    {
+        BasicBlock const &block = entry.second;
+        if (block.selfModified)
+        {
+            ++skipped;
+            continue;
+        }
+
+        for (Segment const &segment : SplitBlock(analysis, block))
+        {
+            std::string name = "Block_" + Hex(segment.start).substr(2);
+            unsigned int pending = 0;
+            unsigned int instructions = 0;
+            bool setsPc = false;
+
+            functions << "static uint8_t const " << name << "_bytes[] = {";
+            for (uint16_t address = segment.start; address < segment.end; ++address)
+            {
+                functions << (address == segment.start ? "" : ", ") << Hex(analysis.GetMemory()[address]);
+            }
+            functions << "};\n\n";
+
+            functions << "static void " << name << "(AotContext &c)\n{\n";
+            for (uint16_t address = segment.start; address < segment.end; address += 2)
+            {
+                setsPc = EmitInstruction(functions, address, analysis.GetOpcode(address), pending);
+                ++instructions;
+            }
+            FlushTicks(functions, pending);
+            if (!setsPc)
+            {
+                functions << "\tc.SetPc(" << Hex(segment.end) << ");\n";
+            }
+            functions << "}\n\n";
+
+            table << "\t{" << Hex(segment.start) << ", " << (segment.end - segment.start) << ", "
+                  << instructions << ", " << name << "_bytes, " << name << "},\n";
+            ++blockCount;
+        }
+    }
+
+    std::ofstream out(argv[2]);
+    if (!out)
+    {
+        std::cerr << "Could not write " << argv[2] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    out << "// Generated by chip8aot from " << argv[1] << ". Do not edit.\n";
+    out << "// " << blockCount << " blocks, " << skipped << " self-modified blocks left to the interpreter\n\n";
+    out << "#include \"aot.hpp\"\n\n";
+    out << functions.str();
+    if (blockCount > 0)
+    {
+        out << "static AotBlock const blocks[] = {\n" << table.str() << "};\n\n";
+        out << "static AotProgram const program = {AOT_PROGRAM_VERSION, AotContext::MachineSize(), "
+               "AotContext::FieldOffsets(), sizeof(blocks) / sizeof(blocks[0]), blocks};\n\n";
+    }
+    else
+    {
+        out << "static AotProgram const program = {AOT_PROGRAM_VERSION, AotContext::MachineSize(), "
+               "AotContext::FieldOffsets(), 0, nullptr};\n\n";
+    }
+    out << "extern \"C\" AotProgram const *mayochip8_aot_program()\n{\n\treturn &program;\n}\n";
+    return 0;
+}
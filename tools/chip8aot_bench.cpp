@@ -0,0 +1,62 @@
+#include "aotplugin.hpp"
+#include "chip8.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Run a ROM for a fixed number of cycles on the interpreter and on a
+// recompiled plug-in, check that both end in the same state and report the
+// throughput of each.
+int main(int argc, char **argv)
+{
+    if (argc != 4 && argc != 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <Plugin> <ROM> <Cycles> [Seed]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    AotProgram const *program = LoadAotPlugin(argv[1]);
+    if (!program)
+    {
+        std::cerr << "Could not load plug-in " << argv[1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint64_t cycles = std::stoull(argv[3]);
+    unsigned int seed = argc == 5 ? std::stoul(argv[4]) : 1;
+
+    Chip8 interpreted;
+    interpreted.LoadRom(argv[2]);
+    interpreted.SeedRandom(seed);
+
+    Chip8 compiled;
+    compiled.LoadRom(argv[2]);
+    compiled.SeedRandom(seed);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < cycles; ++i)
+    {
+        interpreted.Cycle();
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    AotBackend backend(program);
+    backend.Run(compiled, cycles);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double interpreterSeconds = std::chrono::duration<double>(middle - start).count();
+    double compiledSeconds = std::chrono::duration<double>(end - middle).count();
+
+    std::cout << "interpreter: " << cycles / interpreterSeconds / 1e6 << " Mcycles/s\n";
+    std::cout << "aot:         " << cycles / compiledSeconds / 1e6 << " Mcycles/s ("
+              << backend.GetCompiledCycles() * 100.0 / cycles << "% compiled)\n";
+    std::cout << "speedup:     " << interpreterSeconds / compiledSeconds << "x\n";
+
+    if (!interpreted.SameState(compiled))
+    {
+        std::cout << "state: MISMATCH\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "state: match\n";
+    return 0;
+}
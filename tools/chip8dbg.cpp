@@ -0,0 +1,237 @@
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include "lockstep.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Line-oriented front end for Debugger. Commands come from stdin, so a
+// session can be typed or piped in from a file.
+
+const uint64_t DEFAULT_CONTINUE_CYCLES = 10000000;
+
+static char const *StopReasonName(StopReason reason)
+{
+    switch (reason)
+    {
+    case StopReason::None:
+        return "none";
+    case StopReason::Breakpoint:
+        return "breakpoint";
+    case StopReason::ReadWatchpoint:
+        return "read watchpoint";
+    case StopReason::WriteWatchpoint:
+        return "write watchpoint";
+    case StopReason::RegisterCondition:
+        return "register condition";
+    case StopReason::StepComplete:
+        return "step";
+    case StopReason::CycleLimit:
+        return "cycle limit";
+    }
+    return "unknown";
+}
+
+static void PrintHelp()
+{
+    std::cout << "b <addr>              add a breakpoint\n"
+              << "d <addr>              remove a breakpoint\n"
+              << "w <addr> [len] r|w|rw add a memory watchpoint (default rw)\n"
+              << "cond <x> changed      stop when Vx changes\n"
+              << "cond <x> == <value>   stop when Vx becomes value (also !=)\n"
+              << "clear                 remove all breakpoints, watchpoints and conditions\n"
+              << "s                     step one instruction\n"
+              << "n                     step over a CALL\n"
+              << "c [cycles]            continue\n"
+              << "p                     print registers, I, timers and stack\n"
+              << "q                     quit\n";
+}
+
+static void PrintLocation(Chip8 const &chip8, Debugger const &debugger, StopReason reason)
+{
+    uint8_t const *memory = chip8.GetMemory();
+    uint16_t pc = debugger.GetPc();
+    uint16_t opcode = (memory[pc % MEMORY_SIZE] << 8u) | memory[(pc + 1) % MEMORY_SIZE];
+
+    char text[32];
+    std::snprintf(text, sizeof(text), "0x%03X  %04X  ", pc, opcode);
+    std::cout << StopReasonName(reason);
+    if (reason == StopReason::ReadWatchpoint || reason == StopReason::WriteWatchpoint)
+    {
+        char address[16];
+        std::snprintf(address, sizeof(address), " at 0x%03X", debugger.GetWatchAddress());
+        std::cout << address;
+    }
+    std::cout << " after " << debugger.GetCycles() << " cycles\n  " << text << Disassemble(opcode) << "\n";
+}
+
+static void Usage(char const *program)
+{
+    std::cerr << "Usage: " << program << " [--seed N] [--input Script] <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = 1;
+    char const *inputFileName = nullptr;
+
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "--seed") == 0)
+        {
+            seed = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--input") == 0)
+        {
+            inputFileName = argv[arg + 1];
+        }
+        else
+        {
+            Usage(argv[0]);
+        }
+    }
+    if (argc - arg != 1)
+    {
+        Usage(argv[0]);
+    }
+
+    Chip8 chip8;
+    chip8.LoadRom(argv[arg]);
+    if (chip8.GetRomSize() == 0)
+    {
+        std::cerr << "Could not read ROM " << argv[arg] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    chip8.SeedRandom(seed);
+
+    Debugger debugger(chip8);
+    if (inputFileName)
+    {
+        std::vector<InputEvent> input;
+        if (!LoadInputScript(inputFileName, input))
+        {
+            std::cerr << "Could not read input script " << inputFileName << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        debugger.SetInput(std::move(input));
+    }
+
+    std::string line;
+    while (std::cout << "> " << std::flush, std::getline(std::cin, line))
+    {
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command))
+        {
+            continue;
+        }
+
+        try
+        {
+            if (command == "q")
+            {
+                break;
+            }
+            else if (command == "b" || command == "d")
+            {
+                std::string address;
+                words >> address;
+                uint16_t value = static_cast<uint16_t>(std::stoul(address, nullptr, 16));
+                if (command == "b")
+                {
+                    debugger.AddBreakpoint(value);
+                }
+                else
+                {
+                    debugger.RemoveBreakpoint(value);
+                }
+            }
+            else if (command == "w")
+            {
+                std::string address;
+                std::string length = "1";
+                std::string kind = "rw";
+                words >> address;
+                std::string next;
+                if (words >> next)
+                {
+                    if (next == "r" || next == "w" || next == "rw")
+                    {
+                        kind = next;
+                    }
+                    else
+                    {
+                        length = next;
+                        words >> kind;
+                    }
+                }
+                WatchKind watch = kind == "r" ? WatchKind::Read : (kind == "w" ? WatchKind::Write : WatchKind::ReadWrite);
+                debugger.AddWatchpoint(static_cast<uint16_t>(std::stoul(address, nullptr, 16)),
+                                       static_cast<uint16_t>(std::stoul(length, nullptr, 0)), watch);
+            }
+            else if (command == "cond")
+            {
+                std::string reg;
+                std::string compare;
+                std::string value = "0";
+                words >> reg >> compare >> value;
+                RegisterCondition condition{static_cast<uint8_t>(std::stoul(reg, nullptr, 16)), RegisterCompare::Changed,
+                                            static_cast<uint8_t>(std::stoul(value, nullptr, 0))};
+                if (compare == "==")
+                {
+                    condition.compare = RegisterCompare::Equal;
+                }
+                else if (compare == "!=")
+                {
+                    condition.compare = RegisterCompare::NotEqual;
+                }
+                else if (compare != "changed")
+                {
+                    std::cout << "unknown comparison " << compare << "\n";
+                    continue;
+                }
+                debugger.AddRegisterCondition(condition);
+            }
+            else if (command == "clear")
+            {
+                debugger.ClearAll();
+            }
+            else if (command == "s")
+            {
+                PrintLocation(chip8, debugger, debugger.Step());
+            }
+            else if (command == "n")
+            {
+                PrintLocation(chip8, debugger, debugger.StepOver(DEFAULT_CONTINUE_CYCLES));
+            }
+            else if (command == "c")
+            {
+                std::string cycles;
+                uint64_t limit = (words >> cycles) ? std::stoull(cycles) : DEFAULT_CONTINUE_CYCLES;
+                PrintLocation(chip8, debugger, debugger.Continue(limit));
+            }
+            else if (command == "p")
+            {
+                debugger.PrintRegisters(std::cout);
+                debugger.PrintIndex(std::cout);
+                debugger.PrintTimers(std::cout);
+                debugger.PrintStack(std::cout);
+            }
+            else
+            {
+                PrintHelp();
+            }
+        }
+        catch (std::exception const &)
+        {
+            std::cout << "could not parse: " << line << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "aotplugin.hpp"
+#include "chip8.hpp"
+#include "lockstep.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Run a ROM on two backends in lockstep and report the first point where
+// they disagree. The first backend is the reference and runs one instruction
+// at a time; the second runs in chunks of up to --budget cycles.
+
+static void Usage(char const *program)
+{
+    std::cerr << "Usage: " << program << " [--seed N] [--input Script] [--budget N] [--check-every N]"
+              << " <Reference> <Candidate> <ROM> <Cycles>\n"
+              << "Backends: interpreter, fused, aot:<Plugin>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static bool MakeBackend(std::string const &spec, LockstepBackend &backend)
+{
+    backend.name = spec;
+    if (spec == "interpreter")
+    {
+        backend.step = [](Chip8 &chip8, unsigned int) {
+            chip8.Cycle();
+            return 1u;
+        };
+        return true;
+    }
+    if (spec == "fused")
+    {
+        backend.step = [](Chip8 &chip8, unsigned int budget) { return chip8.Step(budget); };
+        return true;
+    }
+    if (spec.compare(0, 4, "aot:") == 0)
+    {
+        AotProgram const *program = LoadAotPlugin(spec.c_str() + 4);
+        if (!program)
+        {
+            std::cerr << "Could not load plug-in " << spec.substr(4) << "\n";
+            return false;
+        }
+        auto aot = std::make_shared<AotBackend>(program);
+        backend.step = [aot](Chip8 &chip8, unsigned int budget) { return aot->Step(chip8, budget); };
+        return true;
+    }
+    std::cerr << "Unknown backend " << spec << "\n";
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = 1;
+    unsigned int budget = 64;
+    uint64_t checkEvery = 100000;
+    char const *inputFileName = nullptr;
+
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "--seed") == 0)
+        {
+            seed = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--input") == 0)
+        {
+            inputFileName = argv[arg + 1];
+        }
+        else if (std::strcmp(argv[arg], "--budget") == 0)
+        {
+            budget = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--check-every") == 0)
+        {
+            checkEvery = std::stoull(argv[arg + 1]);
+        }
+        else
+        {
+            Usage(argv[0]);
+        }
+    }
+    if (argc - arg != 4)
+    {
+        Usage(argv[0]);
+    }
+
+    LockstepBackend reference;
+    LockstepBackend candidate;
+    if (!MakeBackend(argv[arg], reference) || !MakeBackend(argv[arg + 1], candidate))
+    {
+        std::exit(EXIT_FAILURE);
+    }
+
+    Chip8 chip8;
+    chip8.LoadRom(argv[arg + 2]);
+    if (chip8.GetRomSize() == 0)
+    {
+        std::cerr << "Could not read ROM " << argv[arg + 2] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    chip8.SeedRandom(seed);
+    uint64_t cycles = std::stoull(argv[arg + 3]);
+
+    std::vector<InputEvent> input;
+    if (inputFileName && !LoadInputScript(inputFileName, input))
+    {
+        std::cerr << "Could not read input script " << inputFileName << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto harness = std::make_unique<LockstepHarness>(reference, candidate, chip8);
+    harness->SetInput(input);
+    harness->SetBudget(budget);
+    harness->SetFullCheckInterval(checkEvery);
+
+    if (!harness->Run(cycles))
+    {
+        harness->PrintDivergence(std::cout);
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "match after " << harness->GetCycles() << " cycles (" << harness->GetFullChecks()
+              << " full checks), state hash " << std::hex << harness->GetStateHash() << "\n";
+    return 0;
+}
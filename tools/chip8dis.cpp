@@ -0,0 +1,34 @@
+#include "analysis.hpp"
+#include "chip8.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+    bool dot = argc == 3 && std::strcmp(argv[1], "--dot") == 0;
+    if (argc != 2 && !dot)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--dot] <ROM>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    Chip8 chip8;
+    chip8.LoadRom(argv[argc - 1]);
+    if (chip8.GetRomSize() == 0)
+    {
+        std::cerr << "Could not read ROM " << argv[argc - 1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    RomAnalysis analysis(chip8);
+    if (dot)
+    {
+        analysis.DumpDot(std::cout);
+    }
+    else
+    {
+        analysis.DumpText(std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "chip8.hpp"
+#include "fuzz.hpp"
+#include "lockstep.hpp"
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Coverage-guided fuzzing of keypad input. Every thread takes an input
+// sequence from the shared corpus, mutates it and runs it from a snapshot of
+// the freshly loaded ROM. Inputs that reach new instruction addresses join
+// the corpus; inputs that fault are written out as input scripts that
+// --replay (or chip8diff --input) can run again.
+
+struct Shared
+{
+    std::mutex mutex;
+    std::vector<std::vector<InputEvent>> corpus;
+    std::set<std::pair<FuzzFault, uint16_t>> faults;
+    std::atomic<uint64_t> coverage[COVERAGE_WORDS]{};
+    std::atomic<uint64_t> executions{0};
+    std::atomic<bool> stop{false};
+    std::string outDir;
+};
+
+static unsigned int CountCoverage(Shared const &shared)
+{
+    unsigned int count = 0;
+    for (auto const &word : shared.coverage)
+    {
+        count += static_cast<unsigned int>(std::bitset<64>(word.load(std::memory_order_relaxed)).count());
+    }
+    return count;
+}
+
+static std::string HexAddress(uint16_t address)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "%03X", address);
+    return text;
+}
+
+static void Worker(Shared &shared, Chip8 const &initial, uint64_t cycles, uint64_t seed)
+{
+    FuzzExecutor executor(initial, cycles);
+    std::mt19937_64 rng(seed);
+    std::vector<InputEvent> input;
+    std::vector<InputEvent> other;
+
+    while (!shared.stop.load(std::memory_order_relaxed))
+    {
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            input = shared.corpus[rng() % shared.corpus.size()];
+            other = shared.corpus[rng() % shared.corpus.size()];
+        }
+        for (unsigned int i = 1 + rng() % 4; i > 0; --i)
+        {
+            MutateInput(input, other, cycles, rng);
+        }
+
+        FuzzResult result = executor.Run(input);
+        shared.executions.fetch_add(1, std::memory_order_relaxed);
+
+        // Only touch the shared bitmap for words with bits it may lack
+        bool newCoverage = false;
+        uint64_t const *coverage = executor.GetCoverage();
+        for (unsigned int i = 0; i < COVERAGE_WORDS; ++i)
+        {
+            if (coverage[i] & ~shared.coverage[i].load(std::memory_order_relaxed))
+            {
+                uint64_t before = shared.coverage[i].fetch_or(coverage[i], std::memory_order_relaxed);
+                newCoverage |= (coverage[i] & ~before) != 0;
+            }
+        }
+
+        if (newCoverage)
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.corpus.push_back(input);
+            std::string path = shared.outDir + "/corpus-" + std::to_string(shared.corpus.size()) + ".txt";
+            SaveInputScript(path.c_str(), input);
+            std::cout << "new coverage: " << CountCoverage(shared) << " addresses, " << path << "\n";
+        }
+
+        if (result.fault != FuzzFault::None)
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (shared.faults.insert({result.fault, result.pc}).second)
+            {
+                std::string path = shared.outDir + "/" + FuzzFaultName(result.fault) + "-" + HexAddress(result.pc) + ".txt";
+                SaveInputScript(path.c_str(), input);
+                std::cout << FuzzFaultName(result.fault) << " at 0x" << HexAddress(result.pc) << " after "
+                          << result.cycle << " cycles, " << path << "\n";
+            }
+        }
+    }
+}
+
+static void Usage(char const *program)
+{
+    std::cerr << "Usage: " << program << " [--threads N] [--seconds N] [--cycles N] [--seed N] [--out Dir] <ROM>\n"
+              << "       " << program << " --replay <Script> [--cycles N] [--seed N] <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int threadCount = std::thread::hardware_concurrency();
+    unsigned int seconds = 60;
+    uint64_t cycles = 20000;
+    unsigned int seed = 1;
+    std::string outDir = "fuzz-out";
+    char const *replayFileName = nullptr;
+
+    int arg = 1;
+    for (; arg + 1 < argc && std::strncmp(argv[arg], "--", 2) == 0; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "--threads") == 0)
+        {
+            threadCount = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--seconds") == 0)
+        {
+            seconds = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--cycles") == 0)
+        {
+            cycles = std::stoull(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--seed") == 0)
+        {
+            seed = std::stoul(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--out") == 0)
+        {
+            outDir = argv[arg + 1];
+        }
+        else if (std::strcmp(argv[arg], "--replay") == 0)
+        {
+            replayFileName = argv[arg + 1];
+        }
+        else
+        {
+            Usage(argv[0]);
+        }
+    }
+    if (argc - arg != 1 || cycles == 0)
+    {
+        Usage(argv[0]);
+    }
+
+    // The RNG seed is part of the snapshot, so every run of an input is the same
+    Chip8 initial;
+    initial.LoadRom(argv[arg]);
+    if (initial.GetRomSize() == 0)
+    {
+        std::cerr << "Could not read ROM " << argv[arg] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    initial.SeedRandom(seed);
+
+    if (replayFileName)
+    {
+        std::vector<InputEvent> input;
+        if (!LoadInputScript(replayFileName, input))
+        {
+            std::cerr << "Could not read input script " << replayFileName << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        FuzzExecutor executor(initial, cycles);
+        FuzzResult result = executor.Run(input);
+        std::cout << FuzzFaultName(result.fault) << " at 0x" << HexAddress(result.pc) << " after " << result.cycle
+                  << " cycles\n";
+        return result.fault == FuzzFault::None ? 0 : EXIT_FAILURE;
+    }
+
+    std::filesystem::create_directories(outDir);
+    Shared shared;
+    shared.outDir = outDir;
+    shared.corpus.push_back({});
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < (threadCount > 0 ? threadCount : 1); ++i)
+    {
+        threads.emplace_back(Worker, std::ref(shared), std::cref(initial), cycles, seed * 0x9E3779B97F4A7C15ull + i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int elapsed = 1; elapsed <= seconds; ++elapsed)
+    {
+        std::this_thread::sleep_until(start + std::chrono::seconds(elapsed));
+        uint64_t executions = shared.executions.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        std::cout << "[" << elapsed << "s] " << executions << " execs (" << executions / elapsed << "/s), "
+                  << CountCoverage(shared) << " addresses, corpus " << shared.corpus.size() << ", faults "
+                  << shared.faults.size() << "\n";
+    }
+
+    shared.stop = true;
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return shared.faults.empty() ? 0 : EXIT_FAILURE;
+}
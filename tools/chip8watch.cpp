@@ -0,0 +1,105 @@
+#include "stream.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Terminal viewer for a FrameStreamer socket. Redraws the display in place
+// after every packet; if the terminal cannot keep up the publisher simply
+// drops frames for this viewer.
+
+static bool ReadExact(int fd, uint8_t *buffer, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t got = read(fd, buffer, size);
+        if (got <= 0)
+        {
+            return false;
+        }
+        buffer += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <Socket>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(argv[1]) >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long\n";
+        std::exit(EXIT_FAILURE);
+    }
+    std::strcpy(address.sun_path, argv[1]);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "Could not connect to " << argv[1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint8_t image[STREAM_FRAME_BYTES]{};
+    uint8_t header[STREAM_HEADER_SIZE];
+    uint8_t payload[65536];
+    uint64_t rows[VIDEO_HEIGHT];
+    bool synced = false;
+
+    std::cout << "\x1b[2J";
+    while (ReadExact(fd, header, sizeof(header)))
+    {
+        if (header[0] != 'C' || header[1] != '8')
+        {
+            std::cerr << "Bad packet\n";
+            break;
+        }
+        uint32_t frame = header[4] | (header[5] << 8u) | (header[6] << 16u) | (static_cast<uint32_t>(header[7]) << 24u);
+        size_t length = header[8] | (header[9] << 8u);
+        if (!ReadExact(fd, payload, length))
+        {
+            break;
+        }
+
+        if (header[2] == STREAM_KEYFRAME)
+        {
+            std::memset(image, 0, sizeof(image));
+            synced = true;
+        }
+        if (!synced)
+        {
+            continue;
+        }
+        if (!ApplyStreamPayload(payload, length, image))
+        {
+            std::cerr << "Bad payload\n";
+            break;
+        }
+
+        DecodeFrameRows(image, rows);
+        std::string text = "\x1b[H";
+        for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y)
+        {
+            for (unsigned int x = 0; x < VIDEO_WIDTH; ++x)
+            {
+                text += (rows[y] >> (63 - x)) & 1u ? '#' : ' ';
+            }
+            text += '\n';
+        }
+        text += "frame " + std::to_string(frame) + "\x1b[K\n";
+        std::cout << text << std::flush;
+    }
+
+    close(fd);
+    return 0;
+}